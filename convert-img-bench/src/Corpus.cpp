@@ -0,0 +1,120 @@
+#include "Corpus.h"
+
+#include <cmath>
+#include <filesystem>
+#include <limits>
+
+using namespace std;
+
+namespace {
+    // xorshift32: tiny, fast and identical across standard libraries (unlike std::uniform_*).
+    struct Random {
+        uint32_t state;
+
+        explicit Random(const uint32_t seed) : state(seed ? seed : 0x9e3779b9u) {}
+
+        uint32_t next() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+    };
+
+    const char* kind_name(const CorpusKind kind) {
+        switch (kind) {
+        case CorpusKind::Photo: return "photo";
+        case CorpusKind::LineArt: return "lineart";
+        case CorpusKind::Alpha: return "alpha";
+        }
+        return "unknown";
+    }
+
+    // Returns channel values in [0, 1].
+    void photo_pixel(const size_t x, const size_t y, const size_t width, const size_t height, Random& random, double rgb[3]) {
+        const double u = static_cast<double>(x) / width;
+        const double v = static_cast<double>(y) / height;
+        const double noise = (random.next() & 0xff) / 255.0 * 0.08 - 0.04;
+        rgb[0] = 0.5 + 0.4 * sin(u * 6.1 + v * 2.3) + noise;
+        rgb[1] = 0.5 + 0.4 * sin(u * 3.7 - v * 5.9 + 1.0) + noise;
+        rgb[2] = 0.5 + 0.4 * cos(u * 2.2 + v * 4.4) + noise;
+    }
+
+    template<class T>
+    vector<T> fill(const CorpusSpec& spec) {
+        const bool alpha = spec.kind == CorpusKind::Alpha;
+        const size_t channels = alpha ? 4 : 3;
+        const double max_value = static_cast<double>(numeric_limits<T>::max());
+
+        vector<T> data(spec.width * spec.height * channels);
+        Random random(spec.seed);
+
+        // Line art: a sparse grid of one-pixel strokes at pseudo-random offsets.
+        const size_t spacing = max<size_t>(8, spec.width / 24);
+        const size_t offset = random.next() % spacing;
+
+        for (size_t y = 0; y < spec.height; y++) {
+            for (size_t x = 0; x < spec.width; x++) {
+                double pixel[4];
+                if (spec.kind == CorpusKind::LineArt) {
+                    const bool stroke = (x + offset) % spacing == 0 || (y + offset) % spacing == 0 || (x + y) % (spacing * 3) == 0;
+                    pixel[0] = pixel[1] = pixel[2] = stroke ? 0.05 : 0.97;
+                }
+                else {
+                    photo_pixel(x, y, spec.width, spec.height, random, pixel);
+                }
+                if (alpha) {
+                    const double dx = (static_cast<double>(x) / spec.width) - 0.5;
+                    const double dy = (static_cast<double>(y) / spec.height) - 0.5;
+                    pixel[3] = 1.0 - min(1.0, sqrt(dx * dx + dy * dy) * 2.0);
+                }
+                T* out = &data[(y * spec.width + x) * channels];
+                for (size_t c = 0; c < channels; c++) out[c] = static_cast<T>(round(clamp(pixel[c], 0.0, 1.0) * max_value));
+            }
+        }
+        return data;
+    }
+}  // namespace
+
+string CorpusSpec::name() const {
+    return string(kind_name(kind)) + "_" + to_string(width) + "x" + to_string(height) + "_" + to_string(depth) + "bit";
+}
+
+namespace corpus {
+    Magick::Image generate(const CorpusSpec& spec) {
+        Magick::Image image;
+        if (spec.depth == 16) {
+            const vector<uint16_t> data = fill<uint16_t>(spec);
+            image.read(spec.width, spec.height, spec.kind == CorpusKind::Alpha ? "RGBA" : "RGB", Magick::ShortPixel, data.data());
+        }
+        else {
+            const vector<uint8_t> data = fill<uint8_t>(spec);
+            image.read(spec.width, spec.height, spec.kind == CorpusKind::Alpha ? "RGBA" : "RGB", Magick::CharPixel, data.data());
+        }
+        image.depth(spec.depth);
+        return image;
+    }
+
+    vector<CorpusSpec> standard(const size_t max_pixels) {
+        const pair<size_t, size_t> sizes[] = { { 64, 64 }, { 512, 384 }, { 2048, 1536 }, { 8192, 6144 } };  // last: 50 MP
+
+        vector<CorpusSpec> specs;
+        uint32_t seed = 1;
+        for (const auto& [width, height] : sizes) {
+            if (width * height > max_pixels) continue;
+            specs.push_back({ CorpusKind::Photo, width, height, 8, seed++ });
+            specs.push_back({ CorpusKind::Photo, width, height, 16, seed++ });
+            specs.push_back({ CorpusKind::LineArt, width, height, 8, seed++ });
+            specs.push_back({ CorpusKind::Alpha, width, height, 8, seed++ });
+        }
+        return specs;
+    }
+
+    string write(const CorpusSpec& spec, const string& directory, const string& format) {
+        filesystem::create_directories(directory);
+        const string path = (filesystem::path(directory) / (spec.name() + "." + format)).string();
+        Magick::Image image = generate(spec);
+        image.write(path);
+        return path;
+    }
+}  // namespace corpus
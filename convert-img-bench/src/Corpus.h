@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Magick++.h>
+
+// Deterministic synthetic test images. The same spec always yields the same pixels on every
+// machine and build, so timings and output sizes are comparable between runs.
+enum class CorpusKind {
+    Photo,    // smooth gradients with fine noise, compresses like a photograph
+    LineArt,  // flat background with thin strokes, compresses like a diagram or scan
+    Alpha     // photo content with a radial alpha ramp
+};
+
+struct CorpusSpec {
+    CorpusKind kind = CorpusKind::Photo;
+    size_t width = 512;
+    size_t height = 512;
+    size_t depth = 8;  // bits per channel: 8 or 16
+    uint32_t seed = 1;
+
+    std::string name() const;
+};
+
+namespace corpus {
+    Magick::Image generate(const CorpusSpec& spec);
+
+    // The standard matrix: every kind at 8 bit, photos also at 16 bit, sizes from 64 px to 50 MP.
+    // `max_pixels` drops the largest entries for quick runs.
+    std::vector<CorpusSpec> standard(size_t max_pixels = SIZE_MAX);
+
+    // Writes `spec.name() + "." + format` into `directory` and returns the path.
+    std::string write(const CorpusSpec& spec, const std::string& directory, const std::string& format);
+}  // namespace corpus
@@ -0,0 +1,66 @@
+// Cost of the per-file log line on the worker thread, as the CLI logged it before (synchronous
+// logger, every worker serialized on the sink) and after (asynchronous logger with a bounded queue,
+// and the per-file line filtered out below the active level).
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/sinks/basic_file_sink.h>
+
+using namespace std;
+
+namespace {
+    const string input_path = "\"/data/photos/2023/IMG_0001.jpg\"";
+    const string output_path = "\"/data/out/IMG_0001.webp\"";
+
+    spdlog::sink_ptr file_sink() {
+        static const auto sink = make_shared<spdlog::sinks::basic_file_sink_mt>(
+            (filesystem::temp_directory_path() / "convert-img-bench.log").string(), true);
+        return sink;
+    }
+
+    spdlog::logger& sync_logger() {
+        static const auto logger = [] {
+            auto created = make_shared<spdlog::logger>("bench-sync", file_sink());
+            created->set_level(spdlog::level::info);
+            return created;
+        }();
+        return *logger;
+    }
+
+    spdlog::logger& async_logger() {
+        static const auto pool = make_shared<spdlog::details::thread_pool>(8192, 1);
+        static const auto logger = [] {
+            auto created = make_shared<spdlog::async_logger>("bench-async", file_sink(), pool,
+                spdlog::async_overflow_policy::overrun_oldest);
+            created->set_level(spdlog::level::info);
+            return created;
+        }();
+        return *logger;
+    }
+
+    void log_per_file(benchmark::State& state, spdlog::logger& logger, const spdlog::level::level_enum level) {
+        for (auto _ : state) {
+            logger.log(level, "Converting image: {} -> {}", input_path, output_path);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+}  // namespace
+
+static void BM_LogPerFile_Sync(benchmark::State& state) {
+    log_per_file(state, sync_logger(), spdlog::level::info);
+}
+BENCHMARK(BM_LogPerFile_Sync)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_LogPerFile_Async(benchmark::State& state) {
+    log_per_file(state, async_logger(), spdlog::level::info);
+}
+BENCHMARK(BM_LogPerFile_Async)->ThreadRange(1, 8)->UseRealTime();
+
+// What a worker pays now that the per-file line is a debug message and the default level is info.
+static void BM_LogPerFile_Filtered(benchmark::State& state) {
+    log_per_file(state, async_logger(), spdlog::level::debug);
+}
+BENCHMARK(BM_LogPerFile_Filtered)->ThreadRange(1, 8)->UseRealTime();
@@ -0,0 +1,185 @@
+// Microbenchmarks for the stages of a conversion: decode, resample and encode.
+//
+//   convert-img-bench --benchmark_format=json --benchmark_out=results.json
+//   convert-img-bench --benchmark_filter=Encode/webp
+//   convert-img-bench --max-pixels=4000000         (skip the 50 MP corpus entries)
+//   convert-img-bench --write-corpus=<dir> [--corpus-format=png]   (write the corpus to disk and exit)
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <Magick++.h>
+
+#include "Corpus.h"
+#include "convertimg/Converter.h"
+
+using namespace std;
+
+namespace {
+    const char* decode_formats[] = { "png", "jpg", "webp", "tiff" };
+    const char* encode_formats[] = { "png", "jpg", "tiff", "webp", "heif" };
+
+    struct Resampler {
+        const char* name;
+        void (*apply)(Magick::Image& image, const Magick::Geometry& geometry);
+    };
+
+    // `scale` is what convert_image uses today; the others are the candidate quality tiers.
+    const Resampler resamplers[] = {
+        { "sample", [](Magick::Image& image, const Magick::Geometry& g) { image.sample(g); } },
+        { "scale", [](Magick::Image& image, const Magick::Geometry& g) { image.scale(g); } },
+        { "thumbnail", [](Magick::Image& image, const Magick::Geometry& g) { image.thumbnail(g); } },
+        { "resize_triangle", [](Magick::Image& image, const Magick::Geometry& g) {
+            image.filterType(Magick::TriangleFilter);
+            image.resize(g);
+        } },
+        { "resize_lanczos", [](Magick::Image& image, const Magick::Geometry& g) {
+            image.filterType(Magick::LanczosFilter);
+            image.resize(g);
+        } },
+    };
+
+    const pair<const char*, CompressionMode> compressions[] = {
+        { "none", CompressionMode::None }, { "lossy", CompressionMode::Lossy }, { "lossless", CompressionMode::Lossless },
+    };
+
+    void set_pixel_counters(benchmark::State& state, const Magick::Image& image) {
+        state.SetItemsProcessed(state.iterations());
+        state.counters["megapixels/s"] = benchmark::Counter(
+            static_cast<double>(image.columns() * image.rows()) / 1e6 * state.iterations(), benchmark::Counter::kIsRate);
+    }
+
+    // The spec being benchmarked: its source image and encoded inputs, built on first use so a filtered
+    // run only generates what its benchmarks need. Benchmarks run in registration order, one spec after
+    // another, so only the current spec is kept and the 50 MP entries are never all in memory at once.
+    class CorpusCache {
+    public:
+        const Magick::Image& source(const CorpusSpec& spec) {
+            select(spec);
+            if (!source_) source_ = make_unique<Magick::Image>(corpus::generate(spec));
+            return *source_;
+        }
+
+        const Magick::Blob& encoded(const CorpusSpec& spec, const string& format) {
+            const Magick::Image& image = source(spec);
+            unique_ptr<Magick::Blob>& blob = encoded_[format];
+            if (!blob) {
+                Magick::Image copy(image);
+                copy.magick(format);
+                blob = make_unique<Magick::Blob>();
+                copy.write(blob.get());
+            }
+            return *blob;
+        }
+
+    private:
+        void select(const CorpusSpec& spec) {
+            if (spec.name() == name_) return;
+            name_ = spec.name();
+            encoded_.clear();
+            source_.reset();
+        }
+
+        string name_;
+        unique_ptr<Magick::Image> source_;
+        map<string, unique_ptr<Magick::Blob>> encoded_;
+    };
+
+    CorpusCache corpus_cache;
+
+    void register_benchmarks(const vector<CorpusSpec>& specs) {
+        for (const CorpusSpec& spec : specs) {
+            for (const char* format : decode_formats) {
+                benchmark::RegisterBenchmark(("Decode/" + string(format) + "/" + spec.name()).c_str(),
+                    [spec, format](benchmark::State& state) {
+                        const Magick::Blob& encoded = corpus_cache.encoded(spec, format);
+                        for (auto _ : state) {
+                            Magick::Image image(encoded);
+                            benchmark::DoNotOptimize(image.columns());
+                        }
+                        state.SetBytesProcessed(static_cast<int64_t>(encoded.length()) * state.iterations());
+                        set_pixel_counters(state, corpus_cache.source(spec));
+                    })->Unit(benchmark::kMillisecond);
+            }
+
+            for (const Resampler& resampler : resamplers) {
+                benchmark::RegisterBenchmark(("Resample/" + string(resampler.name) + "/" + spec.name()).c_str(),
+                    [spec, &resampler](benchmark::State& state) {
+                        const Magick::Image& source = corpus_cache.source(spec);
+                        const Magick::Geometry half(source.columns() / 2, source.rows() / 2);
+                        for (auto _ : state) {
+                            state.PauseTiming();
+                            Magick::Image image(source);
+                            image.modifyImage();  // force the copy outside the timed region
+                            state.ResumeTiming();
+                            resampler.apply(image, half);
+                        }
+                        set_pixel_counters(state, source);
+                    })->Unit(benchmark::kMillisecond);
+            }
+
+            for (const char* format : encode_formats) {
+                for (const auto& [compression_name, compression] : compressions) {
+                    benchmark::RegisterBenchmark(("Encode/" + string(format) + "/" + compression_name + "/" + spec.name()).c_str(),
+                        [spec, format, compression = compression](benchmark::State& state) {
+                            const Magick::Image& source = corpus_cache.source(spec);
+                            size_t encoded_size = 0;
+                            for (auto _ : state) {
+                                Magick::Image image(source);
+                                image.quality(80);
+                                set_compression(image, "." + string(format), compression);
+                                Magick::Blob blob;
+                                image.write(&blob, format);
+                                encoded_size = blob.length();
+                            }
+                            state.counters["bytes"] = static_cast<double>(encoded_size);
+                            set_pixel_counters(state, source);
+                        })->Unit(benchmark::kMillisecond);
+                }
+            }
+        }
+    }
+
+    // Pulls `--name=value` out of argv so Google Benchmark does not reject it.
+    string take_flag(int& argc, char** argv, const string& name) {
+        const string prefix = "--" + name + "=";
+        for (int i = 1; i < argc; i++) {
+            if (strncmp(argv[i], prefix.c_str(), prefix.size()) == 0) {
+                string value = argv[i] + prefix.size();
+                for (int j = i; j < argc - 1; j++) argv[j] = argv[j + 1];
+                argc--;
+                return value;
+            }
+        }
+        return "";
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    Magick::InitializeMagick(*argv);
+    spdlog::set_level(spdlog::level::err);  // set_compression warns on unsupported combinations
+
+    const string max_pixels = take_flag(argc, argv, "max-pixels");
+    const string corpus_dir = take_flag(argc, argv, "write-corpus");
+    const string corpus_format = take_flag(argc, argv, "corpus-format");
+    const vector<CorpusSpec> specs = corpus::standard(max_pixels.empty() ? SIZE_MAX : stoull(max_pixels));
+
+    if (!corpus_dir.empty()) {
+        for (const CorpusSpec& spec : specs) {
+            cout << corpus::write(spec, corpus_dir, corpus_format.empty() ? "png" : corpus_format) << endl;
+        }
+        return 0;
+    }
+
+    register_benchmarks(specs);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+#include "convertimg/ConvertEngine.h"
+
+namespace py = pybind11;
+using namespace std;
+
+namespace {
+    mutex engine_mutex;
+    shared_ptr<ConvertEngine> engine;
+
+    // Callers hold the returned reference for as long as they use the engine, so a concurrent
+    // `init()` cannot destroy it under them.
+    shared_ptr<ConvertEngine> get_engine() {
+        lock_guard<mutex> lock(engine_mutex);
+        if (!engine) engine = make_shared<ConvertEngine>();
+        return engine;
+    }
+
+    // Rejects strided views (e.g. `memoryview(b)[::2]`), whose bytes are not one contiguous run.
+    void require_contiguous(const py::buffer_info& info) {
+        py::ssize_t expected = info.itemsize;
+        for (py::ssize_t d = info.ndim; d-- > 0;) {
+            if (info.shape[d] > 1 && info.strides[d] != expected) throw py::value_error("data must be a C-contiguous buffer");
+            expected *= info.shape[d];
+        }
+    }
+
+    // Owns the encoded output and exposes it through the buffer protocol, so `memoryview(image)`
+    // and numpy read the Magick blob directly instead of copying it into a `bytes` object.
+    struct EncodedImage {
+        Magick::Blob blob;
+    };
+}  // namespace
+
+PYBIND11_MODULE(convertimg, m) {
+    m.doc() = "Native bindings for libconvertimg";
+
+    py::class_<EncodedImage>(m, "EncodedImage", py::buffer_protocol())
+        .def_buffer([](EncodedImage& image) {
+            return py::buffer_info(const_cast<void*>(image.blob.data()), 1, py::format_descriptor<uint8_t>::format(),
+                static_cast<py::ssize_t>(image.blob.length()), true);
+        })
+        .def("__len__", [](const EncodedImage& image) { return image.blob.length(); })
+        .def("tobytes", [](const EncodedImage& image) {
+            return py::bytes(static_cast<const char*>(image.blob.data()), image.blob.length());
+        });
+
+    m.def("init", [](const unsigned int threads) {
+        py::gil_scoped_release release;
+        shared_ptr<ConvertEngine> previous;
+        {
+            lock_guard<mutex> lock(engine_mutex);
+            previous = std::move(engine);
+            engine = make_shared<ConvertEngine>(threads);
+        }
+        // Waits for the previous engine's outstanding work, unless a running batch still holds it;
+        // then it is destroyed when that batch finishes.
+        previous.reset();
+    }, py::arg("threads") = 0,
+        "Recreate the shared engine with `threads` workers (0: one per CPU core).");
+
+    m.def("convert_bytes", [](const py::buffer& data, const string& format, const int quality,
+                              const double scale, const string& compression, const size_t max_width) {
+        const py::buffer_info input = data.request();
+        require_contiguous(input);
+        ConvertJob job;
+        job.input_data = input.ptr;
+        job.input_size = static_cast<size_t>(input.size * input.itemsize);
+        job.format = format;
+        job.quality = quality;
+        job.scale = scale;
+        job.compression = get_compression_mode(compression);
+        job.max_width = max_width;
+
+        get_engine();  // make sure ImageMagick is initialized
+        ConvertResult result;
+        {
+            // `input` keeps the caller's buffer pinned while the GIL is released.
+            py::gil_scoped_release release;
+            result = ConvertEngine::convert(job);
+        }
+        if (!result.ok) throw runtime_error(result.error);
+        return EncodedImage{ std::move(result.output) };
+    }, py::arg("data"), py::arg("format") = "", py::arg("quality") = 80, py::arg("scale") = 1.0,
+        py::arg("compression") = "", py::arg("max_width") = 0,
+        "Convert an encoded image held in any bytes-like object. Returns an EncodedImage (buffer protocol).");
+
+    m.def("convert_batch", [](const vector<string>& inputs, const vector<string>& outputs, const int quality,
+                              const double scale, const string& compression, const string& format, const bool overwrite) {
+        if (inputs.size() != outputs.size()) throw invalid_argument("inputs and outputs must have the same length");
+
+        vector<ConvertResult> results(inputs.size());
+        {
+            py::gil_scoped_release release;
+            const shared_ptr<ConvertEngine> holder = get_engine();
+            ConvertEngine& shared = *holder;
+            for (size_t i = 0; i < inputs.size(); i++) {
+                ConvertJob job;
+                job.input_path = inputs[i];
+                job.output_path = outputs[i];
+                job.format = format;
+                job.quality = quality;
+                job.scale = scale;
+                job.compression = get_compression_mode(compression);
+                job.overwrite = overwrite;
+                // Each callback writes a distinct slot, so no locking is needed.
+                shared.submit(std::move(job), [&results, i](const ConvertJob&, ConvertResult& result) {
+                    results[i] = std::move(result);
+                });
+            }
+            shared.wait();
+        }
+
+        py::list converted;
+        for (size_t i = 0; i < inputs.size(); i++) {
+            py::dict entry;
+            entry["input"] = inputs[i];
+            entry["ok"] = results[i].ok;
+            entry["ms"] = results[i].milliseconds;
+            if (results[i].ok) entry["output"] = results[i].output_path;
+            else entry["error"] = results[i].error;
+            converted.append(entry);
+        }
+        return converted;
+    }, py::arg("inputs"), py::arg("outputs"), py::arg("quality") = 80, py::arg("scale") = 1.0,
+        py::arg("compression") = "", py::arg("format") = "", py::arg("overwrite") = true,
+        "Convert files in parallel on the native thread pool. Returns one result dict per input.");
+}
@@ -1,14 +1,13 @@
-from PIL import Image
 import click
 import os
 
+import convertimg
+
 
 def convert(input_file, output_file):
-    try:
-        with Image.open(input_file) as img:
-            img.save(output_file)
-    except Exception as e:
-        print(f"Error converting {input_file} to {output_file}: {e}")
+    for result in convertimg.convert_batch([input_file], [output_file]):
+        if not result['ok']:
+            print(f"Error converting {input_file} to {output_file}: {result['error']}")
 
 
 @click.group()
@@ -53,17 +52,23 @@ def batch_convert(input_directory, output_directory, output_format, input_format
     if not os.path.exists(output_directory):
         os.makedirs(output_directory)
 
+    inputs, outputs = [], []
     for root, dirs, files in os.walk(input_directory):
         for file in files:
             file_extension = file.lower().split('.')[-1]
             if filters and file_extension not in filters:
                 continue
             if file_extension in ['png', 'jpg', 'jpeg', 'gif', 'bmp', 'tiff', 'webp', 'heif', 'pdf', 'eps', 'raw']:
-                input_file = os.path.join(root, file)
                 filename_without_extension = os.path.splitext(file)[0]
-                output_file = os.path.join(output_directory, f"{filename_without_extension}.{output_format}")
-                convert(input_file, output_file)
-                print(f"Converted {input_file} to {output_file}")
+                inputs.append(os.path.join(root, file))
+                outputs.append(os.path.join(output_directory, f"{filename_without_extension}.{output_format}"))
+
+    # The whole batch runs on the native thread pool with the GIL released.
+    for result in convertimg.convert_batch(inputs, outputs):
+        if result['ok']:
+            print(f"Converted {result['input']} to {result['output']}")
+        else:
+            print(f"Error converting {result['input']}: {result['error']}")
 
 
 if __name__ == "__main__":
@@ -0,0 +1,49 @@
+import glob
+import os
+import subprocess
+import sys
+
+from pybind11.setup_helpers import Pybind11Extension, build_ext
+from setuptools import setup
+
+root = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+library = os.path.join(root, 'libconvertimg')
+
+include_dirs = [os.path.join(library, 'include')]
+library_dirs = []
+libraries = []
+extra_compile_args = []
+extra_link_args = []
+
+if sys.platform == 'win32':
+    # Same prebuilt ImageMagick and vcpkg packages as the Visual Studio solution.
+    magick = os.path.join(root, 'Dependencies', 'ImageMagick')
+    vcpkg = os.path.join(root, 'vcpkg_installed', 'x64-windows-static')
+    include_dirs += [os.path.join(magick, 'include'), os.path.join(vcpkg, 'include')]
+    library_dirs += [os.path.join(magick, 'lib'), os.path.join(vcpkg, 'lib')]
+    libraries += ['CORE_RL_Magick++_', 'CORE_RL_MagickCore_', 'CORE_RL_MagickWand_', 'spdlog', 'fmt']
+else:
+    def pkg_config(*args):
+        return subprocess.check_output(['pkg-config', *args, 'Magick++', 'spdlog']).decode().split()
+
+    extra_compile_args += pkg_config('--cflags')
+    extra_link_args += pkg_config('--libs')
+
+setup(
+    name='convertimg',
+    version='0.0.2',
+    description='Native bindings for libconvertimg',
+    ext_modules=[
+        Pybind11Extension(
+            'convertimg',
+            ['_convertimg.cpp'] + sorted(glob.glob(os.path.join(library, 'src', '*.cpp'))),
+            include_dirs=include_dirs,
+            library_dirs=library_dirs,
+            libraries=libraries,
+            extra_compile_args=extra_compile_args,
+            extra_link_args=extra_link_args,
+            cxx_std=17,
+        ),
+    ],
+    cmdclass={'build_ext': build_ext},
+)
@@ -0,0 +1,167 @@
+"""End-to-end batch throughput benchmark for convert-img.
+
+Builds the synthetic corpus with convert-img-bench, converts it with convert-img across
+thread counts and output formats, and records files/sec, MB/s, peak RSS and p99 per-file
+latency. With --baseline, fails (exit 1) if any metric regresses beyond --tolerance.
+
+    python bench_batch.py --bin build/convert-img --bench-bin build/convert-img-bench --save baseline.json
+    python bench_batch.py --bin build/convert-img --bench-bin build/convert-img-bench --baseline baseline.json
+"""
+import argparse
+import json
+import math
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+# metric -> True if higher is better
+METRICS = {
+    'files_per_sec': True,
+    'mb_per_sec': True,
+    'p99_ms': False,
+    'peak_rss_mb': False,
+}
+
+
+def build_corpus(bench_bin, directory, max_pixels, input_format):
+    os.makedirs(directory, exist_ok=True)
+    output = subprocess.run(
+        [bench_bin, f'--write-corpus={directory}', f'--max-pixels={max_pixels}', f'--corpus-format={input_format}'],
+        check=True, capture_output=True, text=True).stdout
+    return [line for line in output.splitlines() if line]
+
+
+def percentile(values, p):
+    ordered = sorted(values)
+    if not ordered:
+        return 0.0
+    index = min(len(ordered) - 1, max(0, math.ceil(p / 100.0 * len(ordered)) - 1))
+    return ordered[index]
+
+
+def run_child(command):
+    """Runs `command` and returns (exit code, peak RSS in MB or None)."""
+    process = subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    if hasattr(os, 'wait4'):
+        _, status, usage = os.wait4(process.pid, 0)
+        process.returncode = os.waitstatus_to_exitcode(status)
+        # ru_maxrss is KiB on Linux and bytes on macOS
+        scale = 1024 * 1024 if sys.platform == 'darwin' else 1024
+        return process.returncode, usage.ru_maxrss / scale
+    # Windows: sample the peak working set with psutil when it is installed
+    peak = None
+    try:
+        import psutil
+    except ImportError:
+        return process.wait(), peak
+    try:
+        child = psutil.Process(process.pid)
+        while process.poll() is None:
+            peak = max(peak or 0, child.memory_info().peak_wset / (1024 * 1024))
+            time.sleep(0.05)
+    except (AttributeError, psutil.Error):
+        pass
+    return process.wait(), peak
+
+
+def run_case(convert_bin, corpus, work_dir, threads, output_format):
+    out_dir = os.path.join(work_dir, f'out-{output_format}-{threads}')
+    shutil.rmtree(out_dir, ignore_errors=True)
+    os.makedirs(out_dir)
+    manifest = os.path.join(work_dir, 'jobs.jsonl')
+    results = os.path.join(work_dir, f'results-{output_format}-{threads}.jsonl')
+    with open(manifest, 'w') as f:
+        for path in corpus:
+            f.write(json.dumps({'input': path}) + '\n')
+    if os.path.exists(results):
+        os.remove(results)
+
+    command = [convert_bin, out_dir, '--jobs', manifest, '--jobs-result', results,
+               '-o', output_format, '-t', str(threads), '-f']
+    start = time.perf_counter()
+    code, peak_rss = run_child(command)
+    seconds = time.perf_counter() - start
+    if code != 0:
+        raise RuntimeError(f'{" ".join(command)} exited with {code}')
+
+    with open(results) as f:
+        lines = [json.loads(line) for line in f if line.strip()]
+    failed = [r for r in lines if r.get('status') != 'ok']
+    if failed:
+        raise RuntimeError(f'{len(failed)} job(s) failed, first: {failed[0].get("error")}')
+
+    input_bytes = sum(os.path.getsize(path) for path in corpus)
+    return {
+        'files_per_sec': len(lines) / seconds,
+        'mb_per_sec': input_bytes / (1024 * 1024) / seconds,
+        'p99_ms': percentile([r['ms'] for r in lines], 99),
+        'peak_rss_mb': peak_rss,
+        'seconds': seconds,
+    }
+
+
+def compare(current, baseline, tolerance):
+    """Returns a list of regression messages; empty when everything is within tolerance."""
+    regressions = []
+    for case, metrics in current.items():
+        if case not in baseline:
+            continue
+        for metric, higher_is_better in METRICS.items():
+            now, before = metrics.get(metric), baseline[case].get(metric)
+            if now is None or not before:
+                continue
+            change = (now - before) / before
+            if (-change if higher_is_better else change) > tolerance:
+                regressions.append(f'{case} {metric}: {before:.2f} -> {now:.2f} ({change:+.1%})')
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--bin', required=True, help='path to convert-img')
+    parser.add_argument('--bench-bin', required=True, help='path to convert-img-bench (builds the corpus)')
+    parser.add_argument('--work-dir', help='corpus and output directory (default: a temporary directory)')
+    parser.add_argument('--threads', default=f'1,{os.cpu_count()}', help='comma-separated thread counts')
+    parser.add_argument('--formats', default='jpg,webp,png', help='comma-separated output formats')
+    parser.add_argument('--input-format', default='png', help='format of the corpus files')
+    parser.add_argument('--max-pixels', type=int, default=4_000_000, help='skip corpus images larger than this')
+    parser.add_argument('--repeat', type=int, default=3, help='runs per case; the best run is kept')
+    parser.add_argument('--baseline', help='baseline results to compare against')
+    parser.add_argument('--tolerance', type=float, default=0.10, help='allowed relative regression (default 0.10)')
+    parser.add_argument('--save', help='write results to this file')
+    args = parser.parse_args()
+
+    work_dir = args.work_dir or tempfile.mkdtemp(prefix='convert-img-bench-')
+    corpus = build_corpus(args.bench_bin, os.path.join(work_dir, 'corpus'), args.max_pixels, args.input_format)
+    print(f'Corpus: {len(corpus)} files in {work_dir}')
+
+    results = {}
+    for output_format in args.formats.split(','):
+        for threads in (int(t) for t in args.threads.split(',')):
+            runs = [run_case(args.bin, corpus, work_dir, threads, output_format) for _ in range(args.repeat)]
+            best = min(runs, key=lambda r: r['seconds'])
+            case = f'{output_format}/t{threads}'
+            results[case] = best
+            rss = f'{best["peak_rss_mb"]:.0f} MB' if best['peak_rss_mb'] is not None else 'n/a'
+            print(f'{case:12} {best["files_per_sec"]:8.2f} files/s {best["mb_per_sec"]:8.2f} MB/s '
+                  f'p99 {best["p99_ms"]:8.1f} ms  peak RSS {rss}')
+
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump(results, f, indent=2)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare(results, json.load(f), args.tolerance)
+        for message in regressions:
+            print(f'REGRESSION {message}')
+        if regressions:
+            sys.exit(1)
+        print(f'No regressions beyond {args.tolerance:.0%}')
+
+
+if __name__ == '__main__':
+    main()
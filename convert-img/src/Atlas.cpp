@@ -0,0 +1,210 @@
+#include "Atlas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <Magick++.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "Progress.h"
+#include "convertimg/Converter.h"
+#include "convertimg/ThreadPool.h"
+#include "convertimg/Utils.h"
+
+using namespace std;
+
+namespace {
+    // A horizontal run of the skyline: everything below `y` over [x, x + width) is taken.
+    struct Segment {
+        size_t x;
+        size_t y;
+        size_t width;
+    };
+
+    // Height the skyline from segment `first` on reaches over [x, x + width).
+    size_t resting_height(const vector<Segment>& skyline, size_t first, const size_t x, const size_t width) {
+        size_t y = 0;
+        for (; first < skyline.size() && skyline[first].x < x + width; first++) y = max(y, skyline[first].y);
+        return y;
+    }
+
+    void place(vector<Segment>& skyline, const size_t index, const Segment& added) {
+        const size_t end = added.x + added.width;
+        size_t next = index;
+        while (next < skyline.size() && skyline[next].x < end) {
+            Segment& segment = skyline[next];
+            const size_t segment_end = segment.x + segment.width;
+            if (segment_end <= end) {
+                next++;
+                continue;
+            }
+            segment.width = segment_end - end;
+            segment.x = end;
+            break;
+        }
+        skyline.erase(skyline.begin() + index, skyline.begin() + next);
+        skyline.insert(skyline.begin() + index, added);
+
+        for (size_t i = 0; i + 1 < skyline.size();) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else {
+                i++;
+            }
+        }
+    }
+
+    Magick::Image thumbnail(const string& path, const size_t tile) {
+        Magick::Image image;
+        image.quiet(true);
+        // Shrink-on-load: libjpeg decodes at the smallest scale that is still at least the tile size.
+        const string hint = to_string(tile) + "x" + to_string(tile);
+        image.defineValue("jpeg", "size", hint);
+        image.subRange(1);
+        image.fileName(path);
+        image.read(read_blob(path));
+
+        Magick::Geometry geometry(tile, tile);
+        geometry.greater(true);
+        image.thumbnail(geometry);
+        image.colorSpace(Magick::sRGBColorspace);
+        return image;
+    }
+
+    string map_path(const string& output_path) {
+        return filesystem::path(output_path).replace_extension(".json").string();
+    }
+}
+
+atlas::Layout atlas::pack(const vector<pair<size_t, size_t>>& sizes, const size_t width) {
+    vector<size_t> order(sizes.size());
+    iota(order.begin(), order.end(), size_t(0));
+    stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+        return sizes[a].second != sizes[b].second ? sizes[a].second > sizes[b].second : sizes[a].first > sizes[b].first;
+    });
+
+    Layout layout;
+    layout.placements.resize(sizes.size());
+    vector<Segment> skyline{ { 0, 0, width } };
+    for (const size_t i : order) {
+        const auto [w, h] = sizes[i];
+        if (w > width) throw runtime_error("Cannot pack a " + to_string(w) + " px wide rectangle into a " + to_string(width) + " px wide sheet");
+
+        // Lowest top edge wins, then leftmost.
+        size_t best = 0, best_y = 0, best_top = SIZE_MAX;
+        for (size_t s = 0; s < skyline.size() && skyline[s].x + w <= width; s++) {
+            const size_t y = resting_height(skyline, s, skyline[s].x, w);
+            if (y + h < best_top) {
+                best = s;
+                best_y = y;
+                best_top = y + h;
+            }
+        }
+        const size_t x = skyline[best].x;
+        place(skyline, best, { x, best_top, w });
+        layout.placements[i] = { x, best_y };
+        layout.width = max(layout.width, x + w);
+        layout.height = max(layout.height, best_top);
+    }
+    return layout;
+}
+
+size_t atlas::build(ThreadPool& pool, const string& base, const vector<string>& paths,
+    const string& output_path, const AtlasOptions& options, const bool live_progress)
+{
+    if (options.tile == 0) throw runtime_error("Atlas tile size must be at least 1 px");
+    if (options.tile + options.padding > options.max_width) {
+        throw runtime_error("Atlas width " + to_string(options.max_width) + " px is narrower than one tile");
+    }
+
+    // Thumbnails are decoded in parallel and kept until they are copied into the sheet; at the
+    // tile size that is far less memory than any one of the sources.
+    vector<Magick::Image> thumbnails(paths.size());
+    vector<char> ok(paths.size(), 0);
+    {
+        ProgressReporter progress(paths.size(), live_progress);
+        pool.parallel_for(paths.size(), [&](const size_t i) {
+            try {
+                thumbnails[i] = thumbnail(paths[i], options.tile);
+                ok[i] = 1;
+            }
+            catch (const exception& e) {
+                spdlog::error("Failed to read {}: {}", utils::quote(paths[i]), e.what());
+            }
+            error_code ignored;
+            const auto bytes = filesystem::file_size(paths[i], ignored);
+            progress.add(ok[i] != 0, bytes == static_cast<uintmax_t>(-1) ? 0 : bytes, 0);
+        });
+    }
+
+    vector<size_t> members;
+    vector<pair<size_t, size_t>> sizes;
+    double area = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!ok[i]) continue;
+        members.push_back(i);
+        sizes.emplace_back(thumbnails[i].columns() + options.padding, thumbnails[i].rows() + options.padding);
+        area += static_cast<double>(sizes.back().first) * sizes.back().second;
+    }
+    const size_t failed = paths.size() - members.size();
+    if (members.empty()) throw runtime_error("No readable images for the atlas");
+
+    // Aim for a square sheet; the skyline packer leaves a little slack, hence the 5%.
+    const size_t widest = max_element(sizes.begin(), sizes.end())->first;
+    const size_t width = min(options.max_width, max(widest, static_cast<size_t>(ceil(sqrt(area * 1.05)))));
+    const Layout layout = pack(sizes, width);
+
+    // Thumbnails are exported row by row straight into the sheet's pixels, in parallel: tiles never
+    // overlap, so no thread touches another's rows.
+    vector<unsigned char> pixels(layout.width * layout.height * 4, 0);
+    pool.parallel_for(members.size(), [&](const size_t m) {
+        Magick::Image& image = thumbnails[members[m]];
+        const Placement& at = layout.placements[m];
+        const size_t columns = image.columns();
+        for (size_t row = 0; row < image.rows(); row++) {
+            image.write(0, static_cast<ssize_t>(row), columns, 1, "RGBA", Magick::CharPixel,
+                &pixels[((at.y + row) * layout.width + at.x) * 4]);
+        }
+        image = Magick::Image();
+    });
+
+    string format = utils::get_extension(output_path);
+    if (!format.empty()) format.erase(0, 1);
+    Magick::Image sheet(layout.width, layout.height, "RGBA", Magick::CharPixel, pixels.data());
+    pixels = vector<unsigned char>();
+    Magick::Blob blob;
+    sheet.magick(format.empty() ? "png" : format);
+    sheet.write(&blob);
+    write_blob(blob, output_path);
+
+    nlohmann::json frames = nlohmann::json::object();
+    for (size_t m = 0; m < members.size(); m++) {
+        const size_t i = members[m];
+        const size_t w = sizes[m].first - options.padding, h = sizes[m].second - options.padding;
+        const string name = filesystem::path(paths[i]).lexically_relative(base).generic_string();
+        frames[name.empty() || name == "." ? filesystem::path(paths[i]).filename().generic_string() : name] = {
+            { "frame", { { "x", layout.placements[m].x }, { "y", layout.placements[m].y }, { "w", w }, { "h", h } } },
+            { "sourceSize", { { "w", w }, { "h", h } } },
+        };
+    }
+    const nlohmann::json map = {
+        { "frames", frames },
+        { "meta", { { "image", filesystem::path(output_path).filename().string() },
+            { "size", { { "w", layout.width }, { "h", layout.height } } }, { "padding", options.padding } } },
+    };
+    const string json_path = map_path(output_path);
+    ofstream json(json_path);
+    json << map.dump(2) << '\n';
+    if (!json) throw runtime_error("Failed to write atlas map: " + utils::quote(json_path));
+
+    spdlog::info("Packed {} images into a {}x{} atlas ({:.0f}% filled): {} and {}", members.size(), layout.width, layout.height,
+        100.0 * area / (static_cast<double>(layout.width + options.padding) * (layout.height + options.padding)),
+        utils::quote(output_path), utils::quote(json_path));
+    return failed;
+}
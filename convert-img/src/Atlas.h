@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+struct AtlasOptions {
+    size_t tile = 128;         // thumbnails fit in tile x tile; smaller images keep their size
+    size_t max_width = 4096;   // widest sheet; narrower when the thumbnails fit a squarer one
+    size_t padding = 2;        // transparent pixels right of and below every thumbnail
+};
+
+// Sprite sheets / contact sheets: every input thumbnailed into a single image, with a JSON map of
+// where each one ended up.
+namespace atlas {
+    struct Placement {
+        size_t x = 0;
+        size_t y = 0;
+    };
+
+    struct Layout {
+        std::vector<Placement> placements;  // top-left corner of each rectangle, in input order
+        size_t width = 0;
+        size_t height = 0;
+    };
+
+    // Skyline bottom-left packing of `sizes` (width, height) into a sheet `width` wide, tallest
+    // rectangles first. The returned width and height are those actually used.
+    Layout pack(const std::vector<std::pair<size_t, size_t>>& sizes, size_t width);
+
+    // Thumbnails `paths` on `pool`, packs them and writes the sheet to `output_path` (format from its
+    // extension) and the map to `output_path` with a .json extension, keyed by the path relative to
+    // `base`. Returns the number of inputs that could not be read; those are left out.
+    size_t build(ThreadPool& pool, const std::string& base, const std::vector<std::string>& paths,
+        const std::string& output_path, const AtlasOptions& options, bool live_progress);
+}  // namespace atlas
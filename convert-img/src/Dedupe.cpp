@@ -0,0 +1,190 @@
+#include "Dedupe.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <Magick++.h>
+#include <spdlog/spdlog.h>
+
+#include "JobManifest.h"
+#include "convertimg/Converter.h"
+#include "convertimg/ThreadPool.h"
+#include "convertimg/Utils.h"
+
+using namespace std;
+
+namespace {
+    constexpr size_t chunk_count = 4;
+    constexpr size_t chunk_bits = 16;
+    constexpr unsigned int max_supported_distance = 16;
+    constexpr int min_thumbnail_contrast = 8;  // grey levels between the darkest and brightest thumbnail pixel
+
+    uint16_t chunk_of(const uint64_t hash, const size_t chunk) {
+        return static_cast<uint16_t>(hash >> (chunk * chunk_bits));
+    }
+
+    // Every 16-bit mask with at most `radius` bits set, i.e. the offsets of a chunk's neighbours.
+    vector<uint16_t> masks_within(const unsigned int radius) {
+        vector<uint16_t> masks;
+        for (uint32_t mask = 0; mask < (1u << chunk_bits); mask++) {
+            if (bitset<chunk_bits>(mask).count() <= radius) masks.push_back(static_cast<uint16_t>(mask));
+        }
+        return masks;
+    }
+
+    string hex(const uint64_t value) {
+        char text[17];
+        snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(value));
+        return text;
+    }
+}
+
+optional<uint64_t> dedupe::dhash(const string& path) {
+    try {
+        Magick::Image image;
+        image.quiet(true);
+        // Shrink-on-load: libjpeg decodes straight to 1/2 .. 1/8 scale, no larger than needed.
+        image.defineValue("jpeg", "size", "64x64");
+        image.subRange(1);
+        image.fileName(path);
+        image.read(read_blob(path));
+
+        image.filterType(Magick::BoxFilter);
+        Magick::Geometry thumbnail(9, 8);
+        thumbnail.aspect(true);
+        image.resize(thumbnail);
+
+        array<unsigned char, 9 * 8> pixels{};
+        image.write(0, 0, 9, 8, "I", Magick::CharPixel, pixels.data());
+        const auto [darkest, brightest] = minmax_element(pixels.begin(), pixels.end());
+        if (*brightest - *darkest < min_thumbnail_contrast) return nullopt;
+
+        uint64_t hash = 0;
+        for (size_t y = 0; y < 8; y++) {
+            for (size_t x = 0; x < 8; x++) hash = (hash << 1) | (pixels[y * 9 + x] < pixels[y * 9 + x + 1] ? 1 : 0);
+        }
+        return hash;
+    }
+    catch (Magick::Exception& e) {
+        throw runtime_error("Magick++ exception: " + string(e.what()));
+    }
+}
+
+vector<size_t> dedupe::cluster(
+    const vector<uint64_t>& hashes, const vector<bool>& valid, const unsigned int max_distance, const vector<size_t>& priority)
+{
+    const size_t count = hashes.size();
+
+    // Pigeonhole: two hashes within `max_distance` differ in at most max_distance / 4 bits of at
+    // least one of the four chunks, so probing each chunk's neighbours within that radius finds them.
+    const unsigned int distance_limit = min(max_distance, max_supported_distance);
+    const vector<uint16_t> masks = masks_within(distance_limit / chunk_count);
+
+    // Per chunk, entries grouped by the value of that chunk (counting sort into one flat array).
+    array<vector<uint32_t>, chunk_count> offsets, entries;
+    for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+        offsets[chunk].assign((1u << chunk_bits) + 1, 0);
+        for (size_t i = 0; i < count; i++) {
+            if (valid[i]) offsets[chunk][chunk_of(hashes[i], chunk) + 1]++;
+        }
+        partial_sum(offsets[chunk].begin(), offsets[chunk].end(), offsets[chunk].begin());
+        entries[chunk].resize(offsets[chunk].back());
+        vector<uint32_t> fill(offsets[chunk].begin(), offsets[chunk].end() - 1);
+        for (size_t i = 0; i < count; i++) {
+            if (valid[i]) entries[chunk][fill[chunk_of(hashes[i], chunk)]++] = static_cast<uint32_t>(i);
+        }
+    }
+
+    // Greedy leader clustering: the first unassigned entry in `priority` leads a new cluster and takes
+    // every unassigned entry within the limit of itself, so no member is ever further than that from
+    // its leader (unlike a transitive closure, where chains link images that are far apart).
+    vector<size_t> leaders(count, SIZE_MAX);
+    for (const size_t i : priority) {
+        if (leaders[i] != SIZE_MAX) continue;
+        leaders[i] = i;
+        if (!valid[i]) continue;
+        for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+            const uint16_t key = chunk_of(hashes[i], chunk);
+            for (const uint16_t mask : masks) {
+                const uint16_t probe = key ^ mask;
+                for (uint32_t e = offsets[chunk][probe]; e < offsets[chunk][probe + 1]; e++) {
+                    const size_t j = entries[chunk][e];
+                    if (leaders[j] == SIZE_MAX && distance(hashes[i], hashes[j]) <= distance_limit) leaders[j] = i;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (leaders[i] == SIZE_MAX) leaders[i] = i;
+    }
+    return leaders;
+}
+
+vector<string> dedupe::filter(const vector<string>& paths, const DedupeOptions& options) {
+    const auto start = chrono::steady_clock::now();
+    if (MagickCore::IsMagickCoreInstantiated() == MagickCore::MagickFalse) Magick::InitializeMagick(nullptr);
+
+    vector<uint64_t> hashes(paths.size(), 0);
+    vector<bool> valid(paths.size(), false);
+    vector<uint64_t> bytes(paths.size(), 0);
+    size_t flat = 0;
+    {
+        vector<char> ok(paths.size(), 0);  // vector<bool> packs bits, which threads cannot write independently
+        vector<char> uniform(paths.size(), 0);
+        ThreadPool pool(options.threads != 0 ? options.threads : max(thread::hardware_concurrency(), 1u));
+        pool.parallel_for(paths.size(), [&](const size_t i) {
+            error_code ignored;
+            const auto size = filesystem::file_size(paths[i], ignored);
+            bytes[i] = size == static_cast<uintmax_t>(-1) ? 0 : size;
+            try {
+                const optional<uint64_t> hash = dhash(paths[i]);
+                if (hash) hashes[i] = *hash;
+                ok[i] = hash.has_value();
+                uniform[i] = !hash.has_value();
+            }
+            catch (const exception& e) {
+                spdlog::debug("Cannot hash {}: {}", utils::quote(paths[i]), e.what());
+            }
+        });
+        for (size_t i = 0; i < paths.size(); i++) valid[i] = ok[i] != 0;
+        flat = count(uniform.begin(), uniform.end(), 1);
+    }
+
+    // The largest file leads its cluster: usually the least recompressed copy.
+    vector<size_t> priority(paths.size());
+    iota(priority.begin(), priority.end(), size_t(0));
+    sort(priority.begin(), priority.end(), [&](const size_t a, const size_t b) {
+        return bytes[a] != bytes[b] ? bytes[a] > bytes[b] : paths[a] < paths[b];
+    });
+    const vector<size_t> representative = cluster(hashes, valid, options.max_distance, priority);
+
+    vector<string> kept;
+    size_t duplicates = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        const bool is_representative = representative[i] == i;
+        if (!is_representative) duplicates++;
+        if (is_representative || !options.skip_duplicates) kept.push_back(paths[i]);
+    }
+
+    if (!options.report_path.empty()) {
+        ofstream report(options.report_path, ios::binary);
+        report << "path,cluster,representative,distance,dhash\n";
+        for (size_t i = 0; i < paths.size(); i++) {
+            const size_t best = representative[i];
+            report << quote_csv(paths[i]) << "," << best << "," << quote_csv(paths[best]) << ","
+                << (valid[i] ? to_string(distance(hashes[i], hashes[best])) : "") << "," << (valid[i] ? hex(hashes[i]) : "") << "\n";
+        }
+        report.flush();
+        if (!report) throw runtime_error("Failed to write near-duplicate report: " + utils::quote(options.report_path));
+    }
+
+    const auto elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    spdlog::info("Near-duplicates: {} of {} files are copies of another within {} bits ({} unreadable, {} too uniform to compare), found in {:.1f} s{}",
+        duplicates, paths.size(), min(options.max_distance, max_supported_distance), count(valid.begin(), valid.end(), false) - flat, flat, elapsed,
+        options.skip_duplicates && duplicates != 0 ? "; converting one per cluster" : "");
+    return kept;
+}
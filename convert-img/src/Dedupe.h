@@ -0,0 +1,43 @@
+#pragma once
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct DedupeOptions {
+    bool skip_duplicates = false;    // convert only one representative per cluster
+    std::string report_path;         // CSV of every file's cluster and representative
+    unsigned int max_distance = 8;   // differing bits (of 64) that still count as the same image; at most 16
+    unsigned int threads = 0;        // for hashing; 0: one per core
+
+    bool enabled() const { return skip_duplicates || !report_path.empty(); }
+};
+
+// Near-duplicate detection for re-encoded, resized or recompressed copies of the same picture.
+namespace dedupe {
+    // 64-bit difference hash: one bit per horizontally adjacent pixel pair of a 9x8 grayscale
+    // thumbnail, set when brightness increases. JPEGs are decoded at reduced scale, other formats
+    // only their first frame. Empty for nearly uniform thumbnails (solid colour, blank page), whose
+    // bits are noise or all zero whatever the colour. Throws std::runtime_error on unreadable images.
+    std::optional<uint64_t> dhash(const std::string& path);
+
+    // Hamming distance; compiles to a single popcount where the CPU has one.
+    inline unsigned int distance(const uint64_t a, const uint64_t b) {
+        return static_cast<unsigned int>(std::bitset<64>(a ^ b).count());
+    }
+
+    // Representative (leader) of every hash. Entries are taken in `priority` order: each one not yet
+    // in a cluster leads a new one, which takes every remaining hash within `max_distance` of it, so
+    // every member is within that distance of its leader. Candidates come from a multi-index search
+    // over four 16-bit chunks, so the cost stays near linear instead of comparing every pair. Entries
+    // with `valid[i]` false are their own leaders.
+    std::vector<size_t> cluster(const std::vector<uint64_t>& hashes, const std::vector<bool>& valid, unsigned int max_distance,
+        const std::vector<size_t>& priority);
+
+    // Hashes and clusters `paths`, writes the report and returns the paths to convert, in their
+    // original order: all of them, or with `skip_duplicates` the largest file of each cluster.
+    std::vector<std::string> filter(const std::vector<std::string>& paths, const DedupeOptions& options);
+}  // namespace dedupe
@@ -0,0 +1,153 @@
+#include "HttpServer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+#include "Socket.h"
+
+using namespace std;
+
+namespace {
+    string url_decode(const string& text) {
+        string decoded;
+        decoded.reserve(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            if (text[i] == '%' && i + 2 < text.size() && isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+                decoded.push_back(static_cast<char>(stoi(text.substr(i + 1, 2), nullptr, 16)));
+                i += 2;
+            }
+            else if (text[i] == '+') {
+                decoded.push_back(' ');
+            }
+            else {
+                decoded.push_back(text[i]);
+            }
+        }
+        return decoded;
+    }
+
+    const char* status_text(const int status) {
+        switch (status) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 500: return "Internal Server Error";
+        default: return "Unknown";
+        }
+    }
+
+    // Parses the request line and headers. Returns false when the client closed the connection.
+    bool read_request(Socket& socket, HttpRequest& request, bool& keep_alive) {
+        string line;
+        do {
+            if (!socket.read_line(line)) return false;
+        } while (line.empty());  // tolerate stray CRLF between pipelined requests
+
+        const size_t method_end = line.find(' ');
+        const size_t target_end = line.find(' ', method_end + 1);
+        if (method_end == string::npos || target_end == string::npos) throw invalid_argument("Malformed request line");
+        request.method = line.substr(0, method_end);
+        const string target = line.substr(method_end + 1, target_end - method_end - 1);
+        keep_alive = line.compare(target_end + 1, string::npos, "HTTP/1.0") != 0;
+
+        const size_t query_start = target.find('?');
+        request.path = url_decode(target.substr(0, query_start));
+        if (query_start != string::npos) {
+            size_t start = query_start + 1;
+            while (start <= target.size()) {
+                size_t end = target.find('&', start);
+                if (end == string::npos) end = target.size();
+                const string pair = target.substr(start, end - start);
+                const size_t equals = pair.find('=');
+                if (!pair.empty()) {
+                    request.query[url_decode(pair.substr(0, equals))] =
+                        equals == string::npos ? "" : url_decode(pair.substr(equals + 1));
+                }
+                start = end + 1;
+            }
+        }
+
+        while (socket.read_line(line) && !line.empty()) {
+            string header = line;
+            transform(header.begin(), header.end(), header.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+            if (header.rfind("connection:", 0) == 0) {
+                if (header.find("close") != string::npos) keep_alive = false;
+                else if (header.find("keep-alive") != string::npos) keep_alive = true;
+            }
+        }
+        return true;
+    }
+
+    void write_response(const Socket& socket, const HttpResponse& response, const bool keep_alive) {
+        const size_t size = response.data ? response.size : response.body.size();
+        const string head = "HTTP/1.1 " + to_string(response.status) + " " + status_text(response.status) + "\r\n" +
+            "Content-Type: " + response.content_type + "\r\n" +
+            "Content-Length: " + to_string(size) + "\r\n" +
+            "Connection: " + (keep_alive ? "keep-alive" : "close") + "\r\n\r\n";
+        socket.write_all(head);
+        if (response.data) socket.write_all(response.data, response.size);
+        else socket.write_all(response.body);
+    }
+}  // namespace
+
+HttpResponse HttpResponse::text(const int status, const string& message) {
+    HttpResponse response;
+    response.status = status;
+    response.body = message + "\n";
+    return response;
+}
+
+HttpServer::HttpServer(string host, const uint16_t port, Handler handler)
+    : host_(std::move(host)), port_(port), handler_(std::move(handler)) {}
+
+void HttpServer::run() {
+    const Socket listener = Socket::listen_tcp(host_, port_);
+    spdlog::info("HTTP server listening on {}:{}", host_, port_);
+
+    while (true) {
+        Socket client;
+        try {
+            client = listener.accept();
+        }
+        catch (const AcceptError& e) {
+            // As in JobServer: a failed accept only loses that connection.
+            if (!e.retryable()) throw;
+            spdlog::warn("{}", e.what());
+            if (e.exhausted()) this_thread::sleep_for(chrono::milliseconds(100));
+            continue;
+        }
+        auto connection = make_shared<Socket>(std::move(client));
+        thread([this, connection] {
+            try {
+                bool keep_alive = true;
+                while (keep_alive) {
+                    HttpRequest request;
+                    if (!read_request(*connection, request, keep_alive)) break;
+
+                    HttpResponse response;
+                    if (request.method != "GET") {
+                        response = HttpResponse::text(405, "Only GET is supported");
+                    }
+                    else {
+                        try {
+                            response = handler_(request);
+                        }
+                        catch (const exception& e) {
+                            response = HttpResponse::text(500, e.what());
+                        }
+                    }
+                    write_response(*connection, response, keep_alive);
+                }
+            }
+            catch (const exception& e) {
+                spdlog::debug("HTTP connection closed: {}", e.what());
+            }
+        }).detach();
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+struct HttpRequest {
+    std::string method;
+    std::string path;  // URL-decoded, without the query string
+    std::map<std::string, std::string> query;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string content_type = "text/plain";
+    std::string body;
+
+    // Binary payloads are referenced rather than copied into `body`; `owner` keeps them alive.
+    std::shared_ptr<const void> owner;
+    const void* data = nullptr;
+    size_t size = 0;
+
+    static HttpResponse text(int status, const std::string& message);
+};
+
+// Small HTTP/1.1 server (GET only, keep-alive) that runs one thread per connection.
+// Handlers are expected to be blocking and to hand CPU-heavy work off to a ThreadPool themselves.
+class HttpServer {
+public:
+    using Handler = std::function<HttpResponse(const HttpRequest& request)>;
+
+    HttpServer(std::string host, uint16_t port, Handler handler);
+
+    // Blocks, accepting connections until the process is terminated.
+    void run();
+
+private:
+    std::string host_;
+    uint16_t port_;
+    Handler handler_;
+};
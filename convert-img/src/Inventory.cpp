@@ -0,0 +1,220 @@
+#include "Inventory.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <Magick++.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include "JobManifest.h"
+#include "Progress.h"
+#include "convertimg/Converter.h"
+#include "convertimg/ResourceBudget.h"
+#include "convertimg/ThreadPool.h"
+#include "convertimg/Utils.h"
+
+using namespace std;
+
+namespace {
+    struct Row {
+        uint64_t bytes = 0;
+        string format;
+        size_t width = 0;
+        size_t height = 0;
+        size_t depth = 0;
+        string colorspace;
+        bool alpha = false;
+        size_t frames = 0;
+        uint64_t pixels = 0;
+        string error;
+    };
+
+    constexpr array<double, 5> megapixel_edges = { 0.25, 1, 4, 16, 64 };
+    constexpr array<const char*, 6> megapixel_labels = { "<0.25", "0.25-1", "1-4", "4-16", "16-64", ">=64" };
+
+    // Aggregates over every file, updated under the writer's lock.
+    struct Histograms {
+        map<string, pair<uint64_t, uint64_t>> formats;  // files, bytes
+        array<uint64_t, megapixel_labels.size()> megapixels{};
+        map<size_t, uint64_t> depths;
+        map<string, uint64_t> colorspaces;
+        map<size_t, uint64_t> frames;
+        uint64_t alpha = 0;
+        uint64_t failed = 0;
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+        uint64_t pixels = 0;
+
+        void add(const Row& row) {
+            files++;
+            bytes += row.bytes;
+            if (!row.error.empty()) {
+                failed++;
+                return;
+            }
+            auto& format = formats[row.format];
+            format.first++;
+            format.second += row.bytes;
+            const double megapixels_per_frame = static_cast<double>(row.width) * row.height / 1e6;
+            const size_t bucket = upper_bound(megapixel_edges.begin(), megapixel_edges.end(), megapixels_per_frame) - megapixel_edges.begin();
+            megapixels[bucket]++;
+            depths[row.depth]++;
+            colorspaces[row.colorspace]++;
+            frames[row.frames]++;
+            if (row.alpha) alpha++;
+            pixels += row.pixels;
+        }
+    };
+
+    Row ping(const string& path) {
+        Row row;
+        error_code ignored;
+        const auto bytes = filesystem::file_size(path, ignored);
+        row.bytes = bytes == static_cast<uintmax_t>(-1) ? 0 : bytes;
+        try {
+            Magick::ReadOptions options;
+            options.ping(true);
+            options.quiet(true);
+            vector<Magick::Image> frames;
+            if (path.find('[') == string::npos) {
+                Magick::readImages(&frames, path, options);
+            }
+            else {
+                // ImageMagick would read "name[1].png" as frame 1 of "name.png".
+                MagickCore::CopyMagickString(options.imageInfo()->filename, path.c_str(), MagickPathExtent);
+                Magick::readImages(&frames, read_blob(path), options);
+            }
+            if (frames.empty()) throw runtime_error("No image found");
+
+            const Magick::Image& first = frames.front();
+            row.format = first.magick();
+            row.width = first.columns();
+            row.height = first.rows();
+            row.depth = first.depth();
+            const char* colorspace = MagickCore::CommandOptionToMnemonic(MagickCore::MagickColorspaceOptions,
+                static_cast<int>(first.colorSpace()));
+            row.colorspace = colorspace != nullptr ? colorspace : "Undefined";
+            row.alpha = first.alpha();
+            row.frames = frames.size();
+            for (const auto& frame : frames) row.pixels += static_cast<uint64_t>(frame.columns()) * frame.rows();
+        }
+        catch (const exception& e) {
+            row.error = e.what();
+        }
+        return row;
+    }
+
+    string format_row(const string& path, const Row& row) {
+        return quote_csv(filesystem::path(path).generic_string()) + "," + to_string(row.bytes) + "," + quote_csv(row.format) + "," +
+            to_string(row.width) + "," + to_string(row.height) + "," + to_string(row.depth) + "," + quote_csv(row.colorspace) + "," +
+            (row.error.empty() ? (row.alpha ? "1" : "0") : "") + "," + to_string(row.frames) + "," + to_string(row.pixels) + "," +
+            quote_csv(row.error) + "\n";
+    }
+
+    nlohmann::json to_json(const Histograms& h) {
+        nlohmann::json formats = nlohmann::json::object();
+        for (const auto& [name, counts] : h.formats) formats[name] = { { "files", counts.first }, { "bytes", counts.second } };
+        nlohmann::json megapixels = nlohmann::json::object();
+        for (size_t i = 0; i < megapixel_labels.size(); i++) megapixels[megapixel_labels[i]] = h.megapixels[i];
+        nlohmann::json depths = nlohmann::json::object();
+        for (const auto& [depth, count] : h.depths) depths[to_string(depth)] = count;
+        nlohmann::json frames = nlohmann::json::object();
+        for (const auto& [count, files] : h.frames) frames[to_string(count)] = files;
+        return {
+            { "files", h.files }, { "failed", h.failed }, { "bytes", h.bytes }, { "pixels", h.pixels }, { "alpha", h.alpha },
+            { "formats", formats }, { "megapixels", megapixels }, { "depth", depths }, { "colorspace", h.colorspaces },
+            { "frames", frames },
+        };
+    }
+
+    void log_histograms(const Histograms& h) {
+        spdlog::info("Inventory: {} files, {}, {:.1f} gigapixels, {} unreadable",
+            h.files, resources::format_size(h.bytes), h.pixels / 1e9, h.failed);
+        for (const auto& [name, counts] : h.formats) {
+            spdlog::info("  format {:<8} {:>10} files {:>12}", name, counts.first, resources::format_size(counts.second));
+        }
+        for (size_t i = 0; i < megapixel_labels.size(); i++) {
+            if (h.megapixels[i] != 0) spdlog::info("  {:>9} MP    {:>10} files", megapixel_labels[i], h.megapixels[i]);
+        }
+        for (const auto& [depth, count] : h.depths) spdlog::info("  depth {:<9} {:>10} files", depth, count);
+        for (const auto& [name, count] : h.colorspaces) spdlog::info("  colorspace {:<4} {:>10} files", name, count);
+        uint64_t animated = 0;
+        for (const auto& [count, files] : h.frames) {
+            if (count > 1) animated += files;
+        }
+        spdlog::info("  {} with alpha, {} with several frames", h.alpha, animated);
+    }
+}
+
+size_t inventory::run(ThreadPool& pool, const vector<string>& paths, const string& csv_path, const bool live_progress) {
+    ofstream csv(csv_path, ios::binary);
+    if (!csv) throw runtime_error("Failed to open inventory: " + utils::quote(csv_path));
+    csv << "path,bytes,format,width,height,depth,colorspace,alpha,frames,pixels,error\n";
+
+    mutex writer;
+    Histograms histograms;
+    ProgressReporter progress(paths.size(), live_progress);
+    pool.parallel_for(paths.size(), [&](const size_t i) {
+        const Row row = ping(paths[i]);
+        const string line = format_row(paths[i], row);
+        {
+            lock_guard<mutex> lock(writer);
+            csv << line;
+            histograms.add(row);
+        }
+        if (!row.error.empty()) spdlog::debug("Failed to read {}: {}", utils::quote(paths[i]), row.error);
+        progress.add(row.error.empty(), row.bytes, 0);
+    });
+    progress.finish();
+    csv.flush();
+    if (!csv) throw runtime_error("Failed to write inventory: " + utils::quote(csv_path));
+
+    log_histograms(histograms);
+    const string summary_path = csv_path + ".summary.json";
+    ofstream summary(summary_path);
+    summary << to_json(histograms).dump(2) << '\n';
+    if (!summary) throw runtime_error("Failed to write inventory summary: " + utils::quote(summary_path));
+    spdlog::info("Wrote inventory to {} and {}", utils::quote(csv_path), utils::quote(summary_path));
+    return histograms.failed;
+}
+
+CostTable::CostTable(const string& csv_path) {
+    ifstream file(csv_path);
+    if (!file) throw runtime_error("Failed to open inventory: " + utils::quote(csv_path));
+
+    string line;
+    if (!getline(file, line)) return;
+    const vector<string> header = split_csv(line);
+    const auto column = [&](const string& name) {
+        const auto it = find(header.begin(), header.end(), name);
+        if (it == header.end()) throw runtime_error("Inventory " + utils::quote(csv_path) + " has no " + name + " column");
+        return static_cast<size_t>(it - header.begin());
+    };
+    const size_t path_column = column("path");
+    const size_t pixels_column = column("pixels");
+
+    while (getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        const vector<string> fields = split_csv(line);
+        if (fields.size() <= max(path_column, pixels_column)) continue;
+        try {
+            costs_[fields[path_column]] = stoull(fields[pixels_column]);
+        }
+        catch (const exception&) {
+        }
+    }
+}
+
+uint64_t CostTable::cost(const string& path) const {
+    const auto it = costs_.find(filesystem::path(path).generic_string());
+    return it == costs_.end() ? 0 : it->second;
+}
+
+size_t CostTable::size() const {
+    return costs_.size();
+}
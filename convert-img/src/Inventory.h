@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+namespace inventory {
+    // Pings every file in `paths` on `pool` (headers only, no pixels are decoded) and writes one CSV
+    // row per file to `csv_path`: path, bytes, format, width, height, depth, colorspace, alpha,
+    // frames, pixels (all frames), error. Histograms of formats, megapixels, bit depth, colorspace,
+    // alpha and frame counts are logged and written to `<csv_path>.summary.json`. Returns the number
+    // of files that could not be read.
+    size_t run(ThreadPool& pool, const std::vector<std::string>& paths, const std::string& csv_path, bool live_progress);
+}  // namespace inventory
+
+// Per-file work estimates (pixels over all frames) from an `--inventory` report, keyed by the path
+// as the report lists it.
+class CostTable {
+public:
+    explicit CostTable(const std::string& csv_path);
+
+    // 0 for files the report does not list or could not read.
+    uint64_t cost(const std::string& path) const;
+    size_t size() const;
+
+private:
+    std::unordered_map<std::string, uint64_t> costs_;
+};
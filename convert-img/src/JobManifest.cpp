@@ -0,0 +1,106 @@
+#include "JobManifest.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+using namespace std;
+
+namespace {
+    void set_field(ManifestJob& job, const string& key, const string& value) {
+        if (value.empty()) return;
+        if (key == "input") job.input = value;
+        else if (key == "output") job.output = value;
+        else if (key == "format") job.format = value;
+        else if (key == "compression") job.compression = value;
+        else if (key == "quality") job.quality = stoi(value);
+        else if (key == "scale") job.scale = stod(value);
+    }
+
+    ManifestJob parse_json_line(const string& line) {
+        const nlohmann::json object = nlohmann::json::parse(line);
+        if (!object.is_object()) throw invalid_argument("expected a JSON object");
+
+        ManifestJob job;
+        for (const auto& [key, value] : object.items()) {
+            if (key == "quality") job.quality = value.get<int>();
+            else if (key == "scale") job.scale = value.get<double>();
+            else if (value.is_string()) set_field(job, key, value.get<string>());
+        }
+        return job;
+    }
+}  // namespace
+
+vector<string> split_csv(const string& line) {
+    vector<string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        const char c = line[i];
+        if (quoted) {
+            if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+                fields.back().push_back('"');
+                i++;
+            }
+            else if (c == '"') quoted = false;
+            else fields.back().push_back(c);
+        }
+        else if (c == '"') quoted = true;
+        else if (c == ',') fields.emplace_back();
+        else fields.back().push_back(c);
+    }
+    return fields;
+}
+
+string quote_csv(const string& field) {
+    if (field.find_first_of(",\"\r\n") == string::npos) return field;
+    string quoted = "\"";
+    for (const char c : field) {
+        if (c == '"') quoted.push_back('"');
+        quoted.push_back(c);
+    }
+    return quoted + "\"";
+}
+
+vector<ManifestJob> read_manifest(const string& path) {
+    ifstream file(path);
+    if (!file) throw runtime_error("Failed to open job manifest: " + path);
+
+    string extension = filesystem::path(path).extension().string();
+    transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    const bool csv = extension == ".csv";
+
+    vector<ManifestJob> jobs;
+    vector<string> columns;
+    string line;
+    size_t line_number = 0;
+    while (getline(file, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.find_first_not_of(" \t") == string::npos || line[0] == '#') continue;
+
+        try {
+            ManifestJob job;
+            if (csv) {
+                const vector<string> fields = split_csv(line);
+                if (columns.empty()) {
+                    columns = fields;
+                    continue;
+                }
+                for (size_t i = 0; i < fields.size() && i < columns.size(); i++) set_field(job, columns[i], fields[i]);
+            }
+            else {
+                job = parse_json_line(line);
+            }
+            if (job.input.empty()) throw invalid_argument("missing input");
+            job.line = line_number;
+            jobs.push_back(std::move(job));
+        }
+        catch (const exception& e) {
+            throw runtime_error(path + ":" + to_string(line_number) + ": " + e.what());
+        }
+    }
+    return jobs;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// One conversion from a `--jobs` manifest. Unset fields fall back to the command-line options.
+struct ManifestJob {
+    size_t line = 0;  // 1-based line in the manifest, echoed in the result line
+    std::string input;
+    std::string output;
+    std::string format;
+    std::string compression;
+    std::optional<int> quality;
+    std::optional<double> scale;
+};
+
+// Reads a JSONL manifest (one object per line) or, for `.csv` files, a CSV manifest whose header
+// names the columns. Recognized keys: input, output, quality, scale, format, compression.
+// Throws std::runtime_error with the offending line number on malformed input.
+std::vector<ManifestJob> read_manifest(const std::string& path);
+
+// RFC 4180 style CSV fields: quoted when they contain a comma, quote or line break, with "" as an
+// escaped quote.
+std::vector<std::string> split_csv(const std::string& line);
+std::string quote_csv(const std::string& field);
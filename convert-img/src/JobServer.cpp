@@ -0,0 +1,113 @@
+#include "JobServer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+#include "Socket.h"
+#include "convertimg/ThreadPool.h"
+
+using namespace std;
+
+namespace {
+    struct Connection {
+        Socket socket;
+        mutex write_mutex;
+        mutex pending_mutex;
+        condition_variable all_done;
+        size_t pending = 0;
+
+        explicit Connection(Socket&& s) : socket(std::move(s)) {}
+
+        void reply(const string& line) {
+            lock_guard<mutex> lock(write_mutex);
+            try {
+                socket.write_all(line + "\n");
+            }
+            catch (const exception& e) {
+                spdlog::warn("Client went away: {}", e.what());
+            }
+        }
+    };
+}  // namespace
+
+JobServer::JobServer(string socket_path, ThreadPool& pool, Handler handler)
+    : socket_path_(std::move(socket_path)), pool_(pool), handler_(std::move(handler)) {}
+
+void JobServer::run() {
+    const Socket listener = Socket::listen_unix(socket_path_);
+    spdlog::info("Listening on {}", socket_path_);
+
+    while (true) {
+        Socket client;
+        try {
+            client = listener.accept();
+        }
+        catch (const AcceptError& e) {
+            // One failed connection, or running out of descriptors for a moment, must not stop the daemon.
+            if (!e.retryable()) throw;
+            spdlog::warn("{}", e.what());
+            if (e.exhausted()) this_thread::sleep_for(chrono::milliseconds(100));
+            continue;
+        }
+        auto connection = make_shared<Connection>(std::move(client));
+
+        // The reader thread only parses and enqueues; conversions run on the shared pool.
+        thread([this, connection] {
+            string request;
+            while (connection->socket.read_line(request)) {
+                if (request.empty()) continue;
+                {
+                    lock_guard<mutex> lock(connection->pending_mutex);
+                    connection->pending++;
+                }
+                pool_.enqueue([this, connection, request] {
+                    string reply;
+                    try {
+                        reply = handler_(request);
+                    }
+                    catch (const exception& e) {
+                        reply = string("error\t") + e.what();
+                    }
+                    connection->reply(reply);
+
+                    lock_guard<mutex> lock(connection->pending_mutex);
+                    if (--connection->pending == 0) connection->all_done.notify_all();
+                });
+            }
+
+            unique_lock<mutex> lock(connection->pending_mutex);
+            connection->all_done.wait(lock, [&] { return connection->pending == 0; });
+        }).detach();
+    }
+}
+
+namespace job_client {
+    size_t submit(const string& socket_path, const vector<string>& requests,
+                  const function<void(const string& reply)>& on_reply) {
+        Socket socket = Socket::connect_unix(socket_path);
+
+        // Write from a separate thread so a large batch cannot deadlock against unread replies.
+        thread writer([&socket, &requests] {
+            try {
+                for (const auto& request : requests) socket.write_all(request + "\n");
+            }
+            catch (const exception& e) {
+                spdlog::error("Failed to submit jobs: {}", e.what());
+            }
+            socket.shutdown_write();
+        });
+
+        size_t replies = 0;
+        string line;
+        while (socket.read_line(line)) {
+            on_reply(line);
+            replies++;
+        }
+        writer.join();
+        return replies;
+    }
+}  // namespace job_client
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Line-oriented job daemon. Every request line received on a connection is executed on the
+// shared pool and its reply line is streamed back as soon as it completes (in completion order).
+// A connection is closed once the client half-closes and all of its jobs have replied.
+class JobServer {
+public:
+    using Handler = std::function<std::string(const std::string& request)>;
+
+    JobServer(std::string socket_path, ThreadPool& pool, Handler handler);
+
+    // Blocks, accepting connections until the process is terminated.
+    void run();
+
+private:
+    std::string socket_path_;
+    ThreadPool& pool_;
+    Handler handler_;
+};
+
+namespace job_client {
+    // Sends all requests over one connection and invokes `on_reply` for every reply line.
+    // Returns the number of replies received.
+    size_t submit(const std::string& socket_path, const std::vector<std::string>& requests,
+                  const std::function<void(const std::string& reply)>& on_reply);
+}
@@ -0,0 +1,119 @@
+#include "Journal.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+#include "convertimg/Utils.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+    void sync_to_disk(FILE* file) {
+        fflush(file);
+#ifdef _WIN32
+        _commit(_fileno(file));
+#else
+        fsync(fileno(file));
+#endif
+    }
+}
+
+Journal::Journal(const string& path, const bool resume, const chrono::milliseconds sync_interval)
+    : path_(path), resuming_(resume), file_(nullptr), sync_interval_(sync_interval)
+{
+    bool torn = false;
+    if (resume) {
+        ifstream existing(path);
+        string line;
+        while (getline(existing, line)) {
+            torn = existing.eof();  // the last line had no newline
+            // A line cut short by a crash fails to parse and is simply redone.
+            const nlohmann::json entry = nlohmann::json::parse(line, nullptr, false);
+            if (entry.is_object() && entry.contains("in") && entry.contains("out")) {
+                completed_.insert(key(entry["in"].get<string>(), entry["out"].get<string>()));
+            }
+        }
+    }
+
+    file_ = fopen(path.c_str(), resume ? "ab" : "wb");
+    if (file_ == nullptr) throw runtime_error("Failed to open journal: " + utils::quote(path));
+    // Start appending on a fresh line so the first new entry is not glued to the torn one.
+    if (torn) fputc('\n', file_);
+    thread_ = thread([this] { run(); });
+}
+
+Journal::~Journal() {
+    {
+        lock_guard<mutex> lock(pending_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    try {
+        flush();
+    }
+    catch (const exception&) {
+        // Callers that care call flush() themselves first.
+    }
+    fclose(file_);
+}
+
+bool Journal::resuming() const {
+    return resuming_;
+}
+
+bool Journal::completed(const string& input_path, const string& output_path) const {
+    return completed_.count(key(input_path, output_path)) != 0;
+}
+
+size_t Journal::completed_count() const {
+    return completed_.size();
+}
+
+void Journal::record(const string& input_path, const string& output_path) {
+    const string line = nlohmann::json{ { "in", input_path }, { "out", output_path } }.dump() + '\n';
+    lock_guard<mutex> lock(pending_mutex_);
+    pending_ += line;
+}
+
+void Journal::flush() {
+    lock_guard<mutex> write_lock(write_mutex_);
+    string batch;
+    {
+        lock_guard<mutex> lock(pending_mutex_);
+        batch.swap(pending_);
+    }
+    if (batch.empty()) return;
+    if (fwrite(batch.data(), 1, batch.size(), file_) != batch.size()) {
+        // Keep the batch for the next attempt; a partially written line only duplicates an entry.
+        lock_guard<mutex> lock(pending_mutex_);
+        pending_.insert(0, batch);
+        throw runtime_error("Failed to write journal: " + utils::quote(path_));
+    }
+    sync_to_disk(file_);
+}
+
+string Journal::key(const string& input_path, const string& output_path) {
+    return input_path + '\n' + output_path;
+}
+
+void Journal::run() {
+    unique_lock<mutex> lock(pending_mutex_);
+    while (!wake_.wait_for(lock, sync_interval_, [this] { return stopping_; })) {
+        lock.unlock();
+        try {
+            flush();
+        }
+        catch (const exception&) {
+            // Retried on the next interval; the final flush reports the error.
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+// Append-only record of completed jobs, one JSON line ({"in": ..., "out": ...}) per job. Appends are
+// buffered and a background thread writes and fsyncs them every `sync_interval`, so a crash loses at
+// most that much progress; a torn last line is ignored when the journal is read back.
+class Journal {
+public:
+    // Opens `path` for appending. With `resume` the jobs it already lists are loaded as completed;
+    // otherwise the journal is started over.
+    Journal(const std::string& path, bool resume,
+        std::chrono::milliseconds sync_interval = std::chrono::milliseconds(1000));
+    ~Journal();  // flushes
+
+    bool resuming() const;
+    bool completed(const std::string& input_path, const std::string& output_path) const;
+    size_t completed_count() const;
+
+    void record(const std::string& input_path, const std::string& output_path);
+
+    // Writes and fsyncs everything recorded so far.
+    void flush();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+private:
+    static std::string key(const std::string& input_path, const std::string& output_path);
+    void run();
+
+    std::string path_;
+    const bool resuming_;
+    std::unordered_set<std::string> completed_;  // loaded once, read-only afterwards
+    std::FILE* file_;
+    const std::chrono::milliseconds sync_interval_;
+
+    std::mutex pending_mutex_;
+    std::string pending_;
+    std::mutex write_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,39 @@
+#include "LatencyStats.h"
+
+#include <algorithm>
+
+using namespace std;
+
+LatencyStats::LatencyStats(const size_t window) : next_(0), count_(0) {
+    samples_.reserve(window);
+}
+
+void LatencyStats::record(const int64_t microseconds) {
+    lock_guard<mutex> lock(mutex_);
+    if (samples_.size() < samples_.capacity()) {
+        samples_.push_back(microseconds);
+    }
+    else {
+        samples_[next_] = microseconds;
+        next_ = (next_ + 1) % samples_.size();
+    }
+    count_++;
+}
+
+int64_t LatencyStats::percentile(const double fraction) const {
+    vector<int64_t> sorted;
+    {
+        lock_guard<mutex> lock(mutex_);
+        sorted = samples_;
+    }
+    if (sorted.empty()) return 0;
+
+    const size_t rank = min(sorted.size() - 1, static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5));
+    nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+uint64_t LatencyStats::count() const {
+    lock_guard<mutex> lock(mutex_);
+    return count_;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Keeps the most recent latency samples (in microseconds) for percentile reporting.
+class LatencyStats {
+public:
+    explicit LatencyStats(size_t window = 10000);
+
+    void record(int64_t microseconds);
+
+    // `fraction` in [0, 1], e.g. 0.99 for p99. Returns 0 when no samples were recorded.
+    int64_t percentile(double fraction) const;
+    uint64_t count() const;
+
+private:
+    std::vector<int64_t> samples_;
+    size_t next_;
+    uint64_t count_;
+    mutable std::mutex mutex_;
+};
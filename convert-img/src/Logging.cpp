@@ -0,0 +1,54 @@
+#include "Logging.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <spdlog/async.h>
+#include <spdlog/sinks/rotating_file_sink.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+using namespace std;
+
+namespace {
+    constexpr size_t queue_size = 8192;
+}
+
+void logging::setup(const LoggingOptions& options) {
+    const spdlog::level::level_enum level = spdlog::level::from_str(options.level);
+    // from_str falls back to `off` for anything it does not know.
+    if (level == spdlog::level::off && options.level != "off") {
+        throw invalid_argument("Unknown log level: " + options.level);
+    }
+
+    vector<spdlog::sink_ptr> sinks;
+    if (options.to_stderr) sinks.push_back(make_shared<spdlog::sinks::stderr_color_sink_mt>());
+    else sinks.push_back(make_shared<spdlog::sinks::stdout_color_sink_mt>());
+    sinks.back()->set_pattern("[%^%l%$] %v");
+
+    if (!options.file.empty()) {
+        sinks.push_back(make_shared<spdlog::sinks::rotating_file_sink_mt>(options.file, options.file_size, options.file_count));
+        sinks.back()->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%l] [%t] %v");
+    }
+
+    spdlog::init_thread_pool(queue_size, 1);
+    const auto logger = make_shared<spdlog::async_logger>("console", sinks.begin(), sinks.end(),
+        spdlog::thread_pool(), spdlog::async_overflow_policy::overrun_oldest);
+    logger->set_level(level);
+    logger->flush_on(spdlog::level::err);
+    spdlog::set_default_logger(logger);
+    // Long-running servers never reach `shutdown`; keep the file reasonably current.
+    spdlog::flush_every(chrono::seconds(1));
+}
+
+void logging::shutdown() {
+    {
+        const auto pool = spdlog::thread_pool();
+        if (!pool) return;
+        const size_t dropped = pool->overrun_counter();
+        if (dropped != 0) spdlog::warn("Dropped {} log message(s) because the log queue was full", dropped);
+    }
+    // Joins the logging thread after it wrote everything still queued.
+    spdlog::shutdown();
+}
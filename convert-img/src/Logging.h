@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+struct LoggingOptions {
+    std::string level = "info";  // trace, debug, info, warn, error, critical, off
+    bool to_stderr = false;      // keep stdout free, e.g. when it carries the encoded image
+    std::string file;            // optional rotating log file
+    uint64_t file_size = 10 * 1024 * 1024;
+    size_t file_count = 3;
+};
+
+namespace logging {
+    // Installs an asynchronous default logger: workers only push into a bounded queue and one
+    // background thread writes to the console (and file) sinks. When the queue is full the oldest
+    // messages are dropped rather than stalling conversions. Throws on an unknown level.
+    void setup(const LoggingOptions& options);
+
+    // Drains the queue, reports dropped messages and stops the logging thread. Safe to call twice.
+    void shutdown();
+}  // namespace logging
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Thread-safe LRU cache bounded by the total byte size of its values rather than by entry count.
+// Values are held by shared_ptr so a hit can be served while the entry is concurrently evicted.
+template<class Key, class Value>
+class LruCache {
+public:
+    using ValuePtr = std::shared_ptr<const Value>;
+
+    explicit LruCache(size_t capacity_bytes) : capacity_(capacity_bytes), size_(0) {}
+
+    ValuePtr get(const Key& key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = index_.find(key);
+        if (it == index_.end()) return nullptr;
+        entries_.splice(entries_.begin(), entries_, it->second);  // mark most recently used
+        return it->second->value;
+    }
+
+    void put(const Key& key, ValuePtr value, size_t bytes) {
+        if (bytes > capacity_) return;  // would evict everything and still not fit
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto it = index_.find(key);
+        if (it != index_.end()) {
+            size_ -= it->second->bytes;
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+        entries_.push_front({ key, std::move(value), bytes });
+        index_[key] = entries_.begin();
+        size_ += bytes;
+
+        while (size_ > capacity_) {
+            const Entry& oldest = entries_.back();
+            size_ -= oldest.bytes;
+            index_.erase(oldest.key);
+            entries_.pop_back();
+        }
+    }
+
+    size_t size_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return size_;
+    }
+
+    size_t count() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return index_.size();
+    }
+
+    size_t capacity_bytes() const { return capacity_; }
+
+private:
+    struct Entry {
+        Key key;
+        ValuePtr value;
+        size_t bytes;
+    };
+
+    const size_t capacity_;
+    size_t size_;
+    std::list<Entry> entries_;
+    std::unordered_map<Key, typename std::list<Entry>::iterator> index_;
+    mutable std::mutex mutex_;
+};
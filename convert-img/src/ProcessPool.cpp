@@ -0,0 +1,649 @@
+#include "ProcessPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include <Magick++.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+    constexpr uint32_t ring_magic = 0x474d4943;  // "CIMG"
+    constexpr size_t max_workers = 256;
+    constexpr size_t max_slots = 1024;
+    constexpr size_t path_capacity = 4096;
+    constexpr size_t error_capacity = 1024;
+    constexpr int max_startup_failures = 3;
+
+    static_assert(atomic<uint64_t>::is_always_lock_free && atomic<uint32_t>::is_always_lock_free,
+        "the shared ring needs lock-free (address-free) atomics");
+
+    // Dmitry Vyukov's bounded MPMC queue. All of its state lives in the shared mapping, so every
+    // process can push and pop; values are tickets (generation << 32 | slot).
+    struct SharedQueue {
+        struct Cell {
+            atomic<uint64_t> sequence;
+            uint64_t value;
+        };
+
+        alignas(64) atomic<uint64_t> enqueue_position;
+        alignas(64) atomic<uint64_t> dequeue_position;
+        uint64_t mask;
+        Cell cells[max_slots * 2];  // room for the copies ProcessPool::requeue may add
+
+        void init(const size_t capacity) {  // power of two
+            mask = capacity - 1;
+            for (size_t i = 0; i < capacity; i++) cells[i].sequence.store(i, memory_order_relaxed);
+            enqueue_position.store(0, memory_order_relaxed);
+            dequeue_position.store(0, memory_order_relaxed);
+        }
+
+        bool push(const uint64_t value) {
+            uint64_t position = enqueue_position.load(memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &cells[position & mask];
+                const int64_t diff = static_cast<int64_t>(cell->sequence.load(memory_order_acquire)) - static_cast<int64_t>(position);
+                if (diff == 0) {
+                    if (enqueue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed)) break;
+                }
+                else if (diff < 0) {
+                    return false;  // full
+                }
+                else {
+                    position = enqueue_position.load(memory_order_relaxed);
+                }
+            }
+            cell->value = value;
+            cell->sequence.store(position + 1, memory_order_release);
+            return true;
+        }
+
+        bool pop(uint64_t& value) {
+            uint64_t position = dequeue_position.load(memory_order_relaxed);
+            Cell* cell;
+            while (true) {
+                cell = &cells[position & mask];
+                const int64_t diff = static_cast<int64_t>(cell->sequence.load(memory_order_acquire)) - static_cast<int64_t>(position + 1);
+                if (diff == 0) {
+                    if (dequeue_position.compare_exchange_weak(position, position + 1, memory_order_relaxed)) break;
+                }
+                else if (diff < 0) {
+                    return false;  // empty
+                }
+                else {
+                    position = dequeue_position.load(memory_order_relaxed);
+                }
+            }
+            value = cell->value;
+            cell->sequence.store(position + mask + 1, memory_order_release);
+            return true;
+        }
+    };
+
+    // A slot's state packs the generation of its job with the phase and the worker (index + 1) that
+    // claimed it. Workers claim with a compare-exchange from Queued, so stale or duplicate tickets
+    // never run a job twice, and the parent can tell which jobs a dead worker held.
+    enum SlotPhase : uint32_t { Queued, Running, Done, Settled };
+
+    uint64_t slot_state(const uint32_t generation, const SlotPhase phase, const uint32_t worker = 0) {
+        return (static_cast<uint64_t>(generation) << 32) | (static_cast<uint64_t>(worker) << 16) | phase;
+    }
+
+    SlotPhase phase_of(const uint64_t state) {
+        return static_cast<SlotPhase>(state & 0xffff);
+    }
+
+    uint32_t worker_of(const uint64_t state) {
+        return static_cast<uint32_t>(state >> 16) & 0xffff;
+    }
+
+    uint32_t generation_of(const uint64_t state) {
+        return static_cast<uint32_t>(state >> 32);
+    }
+
+    // A job travels to a worker and its result comes back in the same slot.
+    struct JobSlot {
+        atomic<uint64_t> state;
+        char input[path_capacity];
+        char output[path_capacity];
+        char format[32];
+        int32_t quality;
+        int32_t compression;
+        double scale;
+        uint64_t max_width;
+        uint8_t overwrite;
+
+        uint8_t ok;
+        double milliseconds;
+        uint64_t input_bytes;
+        uint64_t output_bytes;
+        char written[path_capacity];
+        char error[error_capacity];
+    };
+
+    struct WorkerState {
+        atomic<uint32_t> claiming;  // set while the worker may hold a popped ticket it has not claimed
+    };
+
+    uint64_t make_ticket(const uint32_t generation, const uint32_t slot) {
+        return (static_cast<uint64_t>(generation) << 32) | slot;
+    }
+
+    bool copy_field(char* target, const size_t capacity, const string& value) {
+        if (value.size() >= capacity) return false;
+        memcpy(target, value.c_str(), value.size() + 1);
+        return true;
+    }
+
+    void copy_truncated(char* target, const size_t capacity, const string& value) {
+        const size_t length = min(value.size(), capacity - 1);
+        memcpy(target, value.data(), length);
+        target[length] = '\0';
+    }
+
+    ConvertResult read_result(const JobSlot& slot) {
+        ConvertResult result;
+        result.ok = slot.ok != 0;
+        result.error = slot.error;
+        result.output_path = slot.written;
+        result.milliseconds = slot.milliseconds;
+        result.input_bytes = slot.input_bytes;
+        result.output_bytes = slot.output_bytes;
+        return result;
+    }
+
+    ConvertResult cancelled_result() {
+        ConvertResult result;
+        result.cancelled = true;
+        result.error = "cancelled";
+        return result;
+    }
+
+    // What jobs that never ran complete with once the pool has given up on starting workers.
+    ConvertResult abandoned_result() {
+        ConvertResult result;
+        result.error = "worker processes failed to start";
+        return result;
+    }
+
+#ifndef _WIN32
+    // Current resident set size; the peak where the current value is not available.
+    uint64_t resident_bytes() {
+        ifstream statm("/proc/self/statm");
+        uint64_t size = 0, resident = 0;
+        if (statm >> size >> resident) return resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+
+    string describe_exit(const int status) {
+        if (WIFSIGNALED(status)) return "worker process crashed (" + string(strsignal(WTERMSIG(status))) + ")";
+        return "worker process exited with code " + to_string(WEXITSTATUS(status));
+    }
+#endif
+}
+
+struct SharedRing {
+    uint32_t magic;
+    uint32_t worker_count;
+    uint32_t slot_count;
+    uint64_t recycle_after;
+    uint64_t recycle_rss_growth;
+    ResourceBudget limits;
+    uint8_t pixel_pool;
+    PixelPoolOptions pixel_pool_options;
+    atomic<uint32_t> shutdown;
+
+    SharedQueue jobs;
+    SharedQueue results;
+    WorkerState workers[max_workers];
+    JobSlot slots[max_slots];  // the mapping is sparse: only the pages of used slots get touched
+};
+
+#ifdef _WIN32
+
+ProcessPool::ProcessPool(unsigned int, ProcessPoolOptions)
+    : processes_(0), ring_(nullptr), ring_bytes_(0), outstanding_(0), startup_failures_(0), requeue_pending_(false), stopping_(false), cancelled_(false), failed_(false)
+{
+    throw runtime_error("--processes is not supported on Windows");
+}
+
+ProcessPool::~ProcessPool() = default;
+void ProcessPool::submit(ConvertJob, Callback) {}
+void ProcessPool::wait() {}
+void ProcessPool::cancel() {}
+bool ProcessPool::failed() const { return false; }
+void ProcessPool::dispatch() {}
+bool ProcessPool::feed() { return false; }
+bool ProcessPool::collect() { return false; }
+bool ProcessPool::reap() { return false; }
+bool ProcessPool::requeue() { return false; }
+void ProcessPool::spawn(size_t) {}
+void ProcessPool::complete(uint32_t, ConvertResult&) {}
+
+int process_pool::run_worker(const string&, size_t) {
+    return 1;
+}
+
+string process_pool::current_executable(const char* argv0) {
+    return argv0;
+}
+
+#else
+
+ProcessPool::ProcessPool(const unsigned int processes, ProcessPoolOptions options)
+    : processes_(clamp<unsigned int>(processes, 1, max_workers)), options_(std::move(options)),
+      ring_(nullptr), ring_bytes_(sizeof(SharedRing)), outstanding_(0), startup_failures_(0), requeue_pending_(false), stopping_(false), cancelled_(false), failed_(false)
+{
+    static atomic<unsigned int> rings_created{ 0 };
+    ring_name_ = "/convert-img-" + to_string(getpid()) + "-" + to_string(rings_created++);
+
+    const int fd = shm_open(ring_name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) throw runtime_error("Failed to create shared memory: " + string(strerror(errno)));
+    if (ftruncate(fd, static_cast<off_t>(ring_bytes_)) != 0) {
+        const string reason = strerror(errno);
+        close(fd);
+        shm_unlink(ring_name_.c_str());
+        throw runtime_error("Failed to size shared memory: " + reason);
+    }
+    void* memory = mmap(nullptr, ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        shm_unlink(ring_name_.c_str());
+        throw runtime_error("Failed to map shared memory: " + string(strerror(errno)));
+    }
+
+    // The fresh mapping is zero-filled, which is a valid state for every atomic in it.
+    ring_ = static_cast<SharedRing*>(memory);
+    ring_->worker_count = processes_;
+    ring_->slot_count = static_cast<uint32_t>(min<size_t>(max_slots, processes_ * 4));
+    ring_->recycle_after = options_.recycle_after;
+    ring_->recycle_rss_growth = options_.recycle_rss_growth;
+    ring_->limits = options_.limits;
+    ring_->pixel_pool = options_.pixel_pool ? 1 : 0;
+    ring_->pixel_pool_options = options_.pixel_pool_options;
+    size_t capacity = 1;
+    while (capacity < ring_->slot_count * 2) capacity <<= 1;
+    ring_->jobs.init(capacity);
+    ring_->results.init(capacity);
+    ring_->magic = ring_magic;
+
+    slots_.resize(ring_->slot_count);
+    for (uint32_t i = ring_->slot_count; i > 0; i--) free_slots_.push_back(i - 1);
+
+    pids_.assign(processes_, -1);
+    for (size_t i = 0; i < processes_; i++) spawn(i);
+    dispatcher_ = thread([this] { dispatch(); });
+}
+
+ProcessPool::~ProcessPool() {
+    wait();
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    dispatcher_.join();
+
+    ring_->shutdown.store(1, memory_order_release);
+    for (const int pid : pids_) {
+        int status = 0;
+        if (pid > 0) waitpid(pid, &status, 0);
+    }
+    munmap(ring_, ring_bytes_);
+    shm_unlink(ring_name_.c_str());
+}
+
+void ProcessPool::submit(ConvertJob job, Callback on_complete) {
+    lock_guard<mutex> lock(mutex_);
+    outstanding_++;
+    pending_.emplace_back(std::move(job), std::move(on_complete));
+}
+
+void ProcessPool::wait() {
+    unique_lock<mutex> lock(mutex_);
+    idle_.wait(lock, [this] { return outstanding_ == 0; });
+}
+
+void ProcessPool::cancel() {
+    cancelled_.store(true, memory_order_relaxed);
+}
+
+bool ProcessPool::failed() const {
+    return failed_.load(memory_order_relaxed);
+}
+
+void ProcessPool::dispatch() {
+    auto last_reap = chrono::steady_clock::now();
+    while (true) {
+        bool progressed = collect();
+        progressed |= feed();
+        if (chrono::steady_clock::now() - last_reap > chrono::milliseconds(10)) {
+            progressed |= reap();
+            last_reap = chrono::steady_clock::now();
+        }
+        {
+            lock_guard<mutex> lock(mutex_);
+            if (stopping_ && outstanding_ == 0) return;
+        }
+        if (!progressed) this_thread::sleep_for(chrono::microseconds(500));
+    }
+}
+
+// Moves pending jobs into free slots and onto the job queue, or drops them once cancelled or given up.
+bool ProcessPool::feed() {
+    bool progressed = false;
+    if (cancelled_.load(memory_order_relaxed) || failed_.load(memory_order_relaxed)) {
+        const ConvertResult outcome = failed_.load(memory_order_relaxed) ? abandoned_result() : cancelled_result();
+        deque<pair<ConvertJob, Callback>> dropped;
+        {
+            lock_guard<mutex> lock(mutex_);
+            dropped.swap(pending_);
+        }
+        for (auto& [job, on_complete] : dropped) {
+            ConvertResult result = outcome;
+            try {
+                if (on_complete) on_complete(job, result);
+            }
+            catch (...) {
+            }
+            lock_guard<mutex> lock(mutex_);
+            if (--outstanding_ == 0) idle_.notify_all();
+        }
+        uint64_t ticket;
+        while (ring_->jobs.pop(ticket)) {
+            progressed = true;
+            const auto index = static_cast<uint32_t>(ticket);
+            const auto generation = static_cast<uint32_t>(ticket >> 32);
+            // Duplicates, and jobs a worker claimed in the meantime, are not settled here.
+            uint64_t expected = slot_state(generation, Queued);
+            if (index >= slots_.size() || !slots_[index].active || slots_[index].generation != generation ||
+                !ring_->slots[index].state.compare_exchange_strong(expected, slot_state(generation, Settled)))
+            {
+                continue;
+            }
+            ConvertResult result = outcome;
+            complete(index, result);
+        }
+        return progressed || !dropped.empty();
+    }
+
+    while (!free_slots_.empty()) {
+        pair<ConvertJob, Callback> next;
+        {
+            lock_guard<mutex> lock(mutex_);
+            if (pending_.empty()) break;
+            next = std::move(pending_.front());
+            pending_.pop_front();
+        }
+        const uint32_t index = free_slots_.back();
+        free_slots_.pop_back();
+        Outstanding& outstanding = slots_[index];
+        outstanding.job = std::move(next.first);
+        outstanding.on_complete = std::move(next.second);
+        outstanding.generation++;
+        outstanding.active = true;
+        progressed = true;
+
+        JobSlot& slot = ring_->slots[index];
+        const ConvertJob& job = outstanding.job;
+        if (job.input_data != nullptr || job.output_path.empty() ||
+            !copy_field(slot.input, path_capacity, job.input_path) ||
+            !copy_field(slot.output, path_capacity, job.output_path) ||
+            !copy_field(slot.format, sizeof(slot.format), job.format))
+        {
+            ConvertResult result;
+            result.error = "job cannot be sent to a worker process (file paths only, up to 4 KiB)";
+            complete(index, result);
+            continue;
+        }
+        slot.quality = job.quality;
+        slot.compression = static_cast<int32_t>(job.compression);
+        slot.scale = job.scale;
+        slot.max_width = job.max_width;
+        slot.overwrite = job.overwrite ? 1 : 0;
+        slot.state.store(slot_state(outstanding.generation, Queued), memory_order_release);
+        if (!ring_->jobs.push(make_ticket(outstanding.generation, index))) requeue_pending_ = true;
+    }
+    return progressed;
+}
+
+bool ProcessPool::collect() {
+    bool progressed = false;
+    uint64_t ticket;
+    while (ring_->results.pop(ticket)) {
+        progressed = true;
+        const auto index = static_cast<uint32_t>(ticket);
+        const auto generation = static_cast<uint32_t>(ticket >> 32);
+        // Results of jobs already settled when their worker died are stale.
+        if (index >= slots_.size() || !slots_[index].active || slots_[index].generation != generation) continue;
+        ConvertResult result = read_result(ring_->slots[index]);
+        complete(index, result);
+    }
+    return progressed;
+}
+
+// Settles the job of every worker that exited and replaces the worker while work remains.
+bool ProcessPool::reap() {
+    bool progressed = false;
+    for (size_t i = 0; i < pids_.size(); i++) {
+        if (pids_[i] > 0) {
+            int status = 0;
+            if (waitpid(pids_[i], &status, WNOHANG) != pids_[i]) continue;
+            pids_[i] = -1;
+            progressed = true;
+
+            // Jobs the worker claimed are settled: finished ones with their result (it may have
+            // died before queuing it), the rest as failed.
+            for (uint32_t index = 0; index < slots_.size(); index++) {
+                if (!slots_[index].active) continue;
+                const uint64_t state = ring_->slots[index].state.load(memory_order_acquire);
+                if (generation_of(state) != slots_[index].generation || worker_of(state) != i + 1) continue;
+                ConvertResult result;
+                if (phase_of(state) == Done) {
+                    result = read_result(ring_->slots[index]);
+                }
+                else {
+                    result.error = describe_exit(status);
+                    spdlog::error("Worker {} died converting {}: {}", i, slots_[index].job.input_path, result.error);
+                }
+                complete(index, result);
+            }
+            if (ring_->workers[i].claiming.load(memory_order_acquire) != 0) requeue_pending_ = true;
+
+            // Recycled workers exit with 0; a non-zero exit code means the worker could not start.
+            if (WIFEXITED(status) && WEXITSTATUS(status) != 0) {
+                if (++startup_failures_ >= max_startup_failures && !failed_.exchange(true, memory_order_relaxed)) {
+                    spdlog::error("Worker processes keep failing to start ({}), giving up", describe_exit(status));
+                }
+            }
+            else {
+                startup_failures_ = 0;
+            }
+        }
+
+        bool work_left;
+        {
+            lock_guard<mutex> lock(mutex_);
+            work_left = outstanding_ > 0;
+        }
+        if (work_left && !cancelled_.load(memory_order_relaxed) && !failed_.load(memory_order_relaxed)) spawn(i);
+    }
+    if (requeue_pending_) progressed |= requeue();
+    return progressed;
+}
+
+// A worker that died between popping a ticket and claiming its slot took the ticket with it, and a
+// push may have found the queue full: every unclaimed job is queued again. Copies still in the queue
+// lose the claim to the first one and are dropped.
+bool ProcessPool::requeue() {
+    requeue_pending_ = false;
+    bool progressed = false;
+    for (uint32_t index = 0; index < slots_.size(); index++) {
+        if (!slots_[index].active) continue;
+        const uint32_t generation = slots_[index].generation;
+        if (ring_->slots[index].state.load(memory_order_acquire) != slot_state(generation, Queued)) continue;
+        if (!ring_->jobs.push(make_ticket(generation, index))) {
+            requeue_pending_ = true;
+            break;
+        }
+        progressed = true;
+    }
+    return progressed;
+}
+
+void ProcessPool::spawn(const size_t worker) {
+    // Everything the child needs is prepared before fork: between fork and exec it may only call
+    // async-signal-safe functions, as other threads of this process may hold locks.
+    vector<string> args = { options_.executable, "--worker", ring_name_, "--worker-index", to_string(worker),
+        "--log-level", options_.log_level };
+    if (!options_.target_profile.empty()) {
+        args.insert(args.end(), { "--target-profile", options_.target_profile, "--intent", options_.rendering_intent });
+    }
+    vector<char*> argv;
+    for (auto& arg : args) argv.push_back(arg.data());
+    argv.push_back(nullptr);
+
+    ring_->workers[worker].claiming.store(0, memory_order_relaxed);
+    const pid_t pid = fork();
+    if (pid == 0) {
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    if (pid < 0) {
+        spdlog::error("Failed to start worker process: {}", strerror(errno));
+        return;
+    }
+    pids_[worker] = pid;
+}
+
+void ProcessPool::complete(const uint32_t slot, ConvertResult& result) {
+    Outstanding& outstanding = slots_[slot];
+    outstanding.active = false;
+    try {
+        if (outstanding.on_complete) outstanding.on_complete(outstanding.job, result);
+    }
+    catch (...) {
+        // A throwing callback must not take down the dispatcher.
+    }
+    outstanding.job = ConvertJob();
+    outstanding.on_complete = nullptr;
+    free_slots_.push_back(slot);
+
+    lock_guard<mutex> lock(mutex_);
+    if (--outstanding_ == 0) idle_.notify_all();
+}
+
+string process_pool::current_executable(const char* argv0) {
+#ifdef __linux__
+    error_code error;
+    const filesystem::path self = filesystem::read_symlink("/proc/self/exe", error);
+    if (!error) return self.string();
+#endif
+    return filesystem::absolute(argv0).string();
+}
+
+int process_pool::run_worker(const string& ring_name, const size_t index) {
+    // Ctrl+C reaches the whole process group; the parent decides when workers stop.
+    signal(SIGINT, SIG_IGN);
+    signal(SIGTERM, SIG_IGN);
+
+    const int fd = shm_open(ring_name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        spdlog::error("Worker failed to open {}: {}", ring_name, strerror(errno));
+        return 1;
+    }
+    void* memory = mmap(nullptr, sizeof(SharedRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        spdlog::error("Worker failed to map {}: {}", ring_name, strerror(errno));
+        return 1;
+    }
+    SharedRing& ring = *static_cast<SharedRing*>(memory);
+    if (ring.magic != ring_magic || index >= ring.worker_count) {
+        spdlog::error("Worker {} does not match ring {}", index, ring_name);
+        return 1;
+    }
+
+    const pid_t parent = getppid();
+    if (ring.pixel_pool != 0) pixel_pool::install(ring.pixel_pool_options);
+    Magick::InitializeMagick(nullptr);
+    // Memory, map and disk are limits per process: each worker gets its share of the whole budget.
+    ResourceBudget budget = resources::derive_budget(ring.worker_count, ring.limits);
+    budget.memory /= ring.worker_count;
+    budget.map /= ring.worker_count;
+    budget.disk /= ring.worker_count;
+    resources::apply(budget);
+    const uint64_t baseline_rss = resident_bytes();
+
+    WorkerState& state = ring.workers[index];
+    const auto self = static_cast<uint32_t>(index + 1);
+    uint64_t jobs_done = 0;
+    unsigned int idle_rounds = 0;
+    while (true) {
+        // Should this process die between the pop and the claim, the parent queues the job again.
+        state.claiming.store(1, memory_order_release);
+        uint64_t ticket;
+        if (!ring.jobs.pop(ticket)) {
+            if (ring.shutdown.load(memory_order_acquire) != 0 || getppid() != parent) return 0;
+            if (++idle_rounds < 64) this_thread::yield();
+            else this_thread::sleep_for(chrono::microseconds(500));
+            continue;
+        }
+        idle_rounds = 0;
+
+        const auto slot_index = static_cast<uint32_t>(ticket);
+        const auto generation = static_cast<uint32_t>(ticket >> 32);
+        if (slot_index >= ring.slot_count) continue;
+        JobSlot& slot = ring.slots[slot_index];
+        uint64_t expected = slot_state(generation, Queued);
+        if (!slot.state.compare_exchange_strong(expected, slot_state(generation, Running, self), memory_order_acq_rel)) continue;
+        state.claiming.store(0, memory_order_release);
+        ConvertJob job;
+        job.input_path = slot.input;
+        job.output_path = slot.output;
+        job.format = slot.format;
+        job.quality = slot.quality;
+        job.compression = static_cast<CompressionMode>(slot.compression);
+        job.scale = slot.scale;
+        job.max_width = static_cast<size_t>(slot.max_width);
+        job.overwrite = slot.overwrite != 0;
+
+        const ConvertResult result = ConvertEngine::convert(job);
+        slot.ok = result.ok ? 1 : 0;
+        slot.milliseconds = result.milliseconds;
+        slot.input_bytes = result.input_bytes;
+        slot.output_bytes = result.output_bytes;
+        copy_truncated(slot.written, path_capacity, result.output_path);
+        copy_truncated(slot.error, error_capacity, result.error);
+        slot.state.store(slot_state(generation, Done, self), memory_order_release);
+        ring.results.push(ticket);  // cannot be full: one cell per slot
+
+        jobs_done++;
+        if (ring.recycle_after != 0 && jobs_done >= ring.recycle_after) return 0;
+        if (ring.recycle_rss_growth != 0 && resident_bytes() > baseline_rss + ring.recycle_rss_growth) return 0;
+    }
+}
+
+#endif
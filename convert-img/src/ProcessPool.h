@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "convertimg/ConvertEngine.h"
+#include "convertimg/PixelPool.h"
+#include "convertimg/ResourceBudget.h"
+
+struct SharedRing;
+
+struct ProcessPoolOptions {
+    std::string executable;                            // re-executed as `<executable> --worker ...`
+    ResourceBudget limits;                             // split between the worker processes
+    std::string log_level = "warn";                    // for the workers' own log output
+    uint64_t recycle_after = 1000;                     // jobs per worker before it is replaced; 0: never
+    uint64_t recycle_rss_growth = 2ull << 30;          // RSS growth (bytes) that gets a worker replaced; 0: never
+    bool pixel_pool = false;                           // install the pixel pool allocator in each worker
+    PixelPoolOptions pixel_pool_options;
+    std::string target_profile;                        // ICC profile the workers convert to; empty: none
+    std::string rendering_intent = "perceptual";
+};
+
+// Runs conversions in separate worker processes instead of threads, so a crashing or leaking coder
+// only takes down (and gets replaced with) one worker, and ImageMagick's process-wide locks are not
+// shared. Jobs and results travel through a lock-free ring in shared memory; workers are fork+exec'd
+// copies of this executable. Same submit/wait/cancel surface as ConvertEngine; callbacks run on the
+// pool's dispatcher thread. POSIX only: the constructor throws on Windows.
+class ProcessPool {
+public:
+    using Callback = ConvertEngine::Callback;
+
+    ProcessPool(unsigned int processes, ProcessPoolOptions options);
+    ~ProcessPool();  // waits for outstanding jobs, then stops the workers
+
+    void submit(ConvertJob job, Callback on_complete);
+    void wait();
+
+    // Queued jobs complete as cancelled; jobs already in a worker finish. Signal-safe.
+    void cancel();
+
+    // True once the pool gave up because worker processes kept failing to start. Every job that had
+    // not finished then completed as failed (not cancelled).
+    bool failed() const;
+
+    ProcessPool(const ProcessPool&) = delete;
+    ProcessPool& operator=(const ProcessPool&) = delete;
+
+private:
+    struct Outstanding {
+        ConvertJob job;
+        Callback on_complete;
+        uint32_t generation = 0;
+        bool active = false;
+    };
+
+    void dispatch();
+    bool feed();
+    bool collect();
+    bool reap();
+    bool requeue();
+    void spawn(size_t worker);
+    void complete(uint32_t slot, ConvertResult& result);
+
+    const unsigned int processes_;
+    const ProcessPoolOptions options_;
+    std::string ring_name_;
+    SharedRing* ring_;
+    size_t ring_bytes_;
+    std::vector<int> pids_;
+
+    std::vector<Outstanding> slots_;  // dispatcher thread only
+    std::vector<uint32_t> free_slots_;
+
+    std::mutex mutex_;
+    std::condition_variable idle_;
+    std::deque<std::pair<ConvertJob, Callback>> pending_;
+    size_t outstanding_;
+    int startup_failures_;  // dispatcher thread only
+    bool requeue_pending_;  // dispatcher thread only
+    bool stopping_;
+    std::atomic<bool> cancelled_;
+    std::atomic<bool> failed_;
+    std::thread dispatcher_;
+};
+
+namespace process_pool {
+    // Entry point of a worker process (`--worker <ring> --worker-index <i>`). Returns the exit code.
+    int run_worker(const std::string& ring_name, size_t index);
+
+    // Absolute path of the running executable, for re-executing it as a worker.
+    std::string current_executable(const char* argv0);
+}
@@ -0,0 +1,102 @@
+#include "Progress.h"
+
+#include <cstdio>
+#include <string>
+#include <spdlog/spdlog.h>
+
+#include "convertimg/ResourceBudget.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+    // Non-terminal output gets a log line this often instead of a redrawn status line.
+    constexpr chrono::seconds log_interval(10);
+
+    string format_eta(const double seconds) {
+        if (seconds < 0 || seconds > 360000) return "--:--";
+        const auto total = static_cast<long long>(seconds + 0.5);
+        char text[32];
+        if (total >= 3600) snprintf(text, sizeof(text), "%lld:%02lld:%02lld", total / 3600, total / 60 % 60, total % 60);
+        else snprintf(text, sizeof(text), "%lld:%02lld", total / 60, total % 60);
+        return text;
+    }
+}
+
+ProgressReporter::ProgressReporter(const size_t total, const bool live, const chrono::milliseconds interval)
+    : total_(total), live_(live && stderr_is_terminal()), interval_(live_ ? interval : log_interval),
+      start_(chrono::steady_clock::now())
+{
+    thread_ = thread([this] { run(); });
+}
+
+ProgressReporter::~ProgressReporter() {
+    finish();
+}
+
+void ProgressReporter::add(const bool ok, const uint64_t bytes_in, const uint64_t bytes_out) {
+    if (!ok) failed_.fetch_add(1, memory_order_relaxed);
+    bytes_in_.fetch_add(bytes_in, memory_order_relaxed);
+    bytes_out_.fetch_add(bytes_out, memory_order_relaxed);
+    done_.fetch_add(1, memory_order_relaxed);
+}
+
+void ProgressReporter::finish() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (finished_) return;
+        finished_ = stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    print(true);
+}
+
+bool ProgressReporter::stderr_is_terminal() {
+#ifdef _WIN32
+    return _isatty(_fileno(stderr)) != 0;
+#else
+    return isatty(fileno(stderr)) != 0;
+#endif
+}
+
+void ProgressReporter::run() {
+    unique_lock<mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, interval_, [this] { return stopping_; })) {
+        lock.unlock();
+        print(false);
+        lock.lock();
+    }
+}
+
+void ProgressReporter::print(const bool final) {
+    const uint64_t done = done_.load(memory_order_relaxed);
+    const uint64_t failed = failed_.load(memory_order_relaxed);
+    const uint64_t bytes_in = bytes_in_.load(memory_order_relaxed);
+    const uint64_t bytes_out = bytes_out_.load(memory_order_relaxed);
+    const double seconds = max(chrono::duration<double>(chrono::steady_clock::now() - start_).count(), 1e-6);
+    const double files_per_second = done / seconds;
+    const double eta = files_per_second > 0 ? (total_ - min<uint64_t>(done, total_)) / files_per_second : -1;
+
+    const string line = fmt::format("{}/{} files ({:.1f}%), {} failed | {:.1f} files/s | in {:.1f} MB/s, out {:.1f} MB/s | {} {}",
+        done, total_, total_ ? 100.0 * done / total_ : 100.0, failed, files_per_second,
+        bytes_in / seconds / (1024 * 1024), bytes_out / seconds / (1024 * 1024),
+        final ? "took" : "ETA", format_eta(final ? seconds : eta));
+
+    if (live_) {
+        // Pad so a shorter line fully covers the previous one.
+        fprintf(stderr, "\r%-110s%s", line.c_str(), final ? "\n" : "");
+        fflush(stderr);
+    }
+    else if (final) {
+        spdlog::info("{} ({} in, {} out)", line, resources::format_size(bytes_in), resources::format_size(bytes_out));
+    }
+    else {
+        spdlog::info(line);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Files done/failed, bytes in/out, rates and ETA for a batch of `total` files. Workers only bump
+// atomic counters; a background thread redraws a single status line on stderr every `interval`
+// (or logs a progress line every few seconds when stderr is not a terminal, or `live` is false).
+class ProgressReporter {
+public:
+    ProgressReporter(size_t total, bool live, std::chrono::milliseconds interval = std::chrono::milliseconds(250));
+    ~ProgressReporter();  // calls finish()
+
+    void add(bool ok, uint64_t bytes_in, uint64_t bytes_out);
+
+    // Stops the refresh thread and prints the final totals once.
+    void finish();
+
+    static bool stderr_is_terminal();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+private:
+    void run();
+    void print(bool final);
+
+    const size_t total_;
+    const bool live_;
+    const std::chrono::milliseconds interval_;
+    const std::chrono::steady_clock::time_point start_;
+
+    std::atomic<uint64_t> done_{ 0 };
+    std::atomic<uint64_t> failed_{ 0 };
+    std::atomic<uint64_t> bytes_in_{ 0 };
+    std::atomic<uint64_t> bytes_out_{ 0 };
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    bool finished_ = false;
+    std::thread thread_;
+};
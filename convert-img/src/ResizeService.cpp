@@ -0,0 +1,78 @@
+#include "ResizeService.h"
+
+#include "convertimg/ThreadPool.h"
+
+using namespace std;
+
+string ResizeRequest::key() const {
+    return path + "|" + to_string(modified) + "|" + to_string(size) + "|" + to_string(width) + "|" + format + "|" + to_string(quality);
+}
+
+ResizeService::ResizeService(ThreadPool& pool, const size_t cache_bytes, Encoder encoder)
+    : pool_(pool), encoder_(std::move(encoder)), cache_(cache_bytes) {}
+
+ResizeService::BlobPtr ResizeService::fetch(const ResizeRequest& request) {
+    const string key = request.key();
+    if (BlobPtr cached = cache_.get(key)) {
+        hits_++;
+        return cached;
+    }
+
+    shared_future<BlobPtr> result;
+    {
+        lock_guard<mutex> lock(inflight_mutex_);
+        // Re-check under the lock: the encoder publishes to the cache before leaving `inflight_`.
+        if (BlobPtr cached = cache_.get(key)) {
+            hits_++;
+            return cached;
+        }
+
+        const auto it = inflight_.find(key);
+        if (it != inflight_.end()) {
+            coalesced_++;
+            result = it->second;
+        }
+        else {
+            misses_++;
+            auto promise = make_shared<std::promise<BlobPtr>>();
+            result = promise->get_future().share();
+            inflight_.emplace(key, result);
+
+            pool_.enqueue([this, request, key, promise] {
+                try {
+                    auto blob = make_shared<const Magick::Blob>(encoder_(request));
+                    cache_.put(key, blob, blob->length());
+                    {
+                        lock_guard<mutex> inflight_lock(inflight_mutex_);
+                        inflight_.erase(key);
+                    }
+                    promise->set_value(std::move(blob));
+                }
+                catch (...) {
+                    {
+                        lock_guard<mutex> inflight_lock(inflight_mutex_);
+                        inflight_.erase(key);
+                    }
+                    promise->set_exception(current_exception());
+                }
+            });
+        }
+    }
+    return result.get();
+}
+
+void ResizeService::record_latency(const int64_t microseconds) {
+    latency_.record(microseconds);
+}
+
+string ResizeService::stats_json() const {
+    return "{\"requests\":" + to_string(latency_.count()) +
+        ",\"hits\":" + to_string(hits_.load()) +
+        ",\"misses\":" + to_string(misses_.load()) +
+        ",\"coalesced\":" + to_string(coalesced_.load()) +
+        ",\"cache_entries\":" + to_string(cache_.count()) +
+        ",\"cache_bytes\":" + to_string(cache_.size_bytes()) +
+        ",\"cache_capacity\":" + to_string(cache_.capacity_bytes()) +
+        ",\"p50_us\":" + to_string(latency_.percentile(0.50)) +
+        ",\"p99_us\":" + to_string(latency_.percentile(0.99)) + "}";
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <Magick++.h>
+
+#include "LatencyStats.h"
+#include "LruCache.h"
+
+class ThreadPool;
+
+struct ResizeRequest {
+    std::string path;    // resolved source file
+    size_t width = 0;    // 0 keeps the source width
+    std::string format;  // output format, e.g. "webp"
+    int quality = 80;
+    int64_t modified = 0;  // source modification time, so edited files are not served from the cache
+    uint64_t size = 0;     // source size in bytes
+
+    std::string key() const;
+};
+
+// Serves encoded variants from a byte-bounded LRU cache. Concurrent misses for the same key are
+// coalesced so each variant is encoded once on the pool while the other requesters wait for it.
+class ResizeService {
+public:
+    using Encoder = std::function<Magick::Blob(const ResizeRequest& request)>;
+    using BlobPtr = std::shared_ptr<const Magick::Blob>;
+
+    ResizeService(ThreadPool& pool, size_t cache_bytes, Encoder encoder);
+
+    // Blocks until the variant is available. Rethrows encoder failures.
+    BlobPtr fetch(const ResizeRequest& request);
+
+    void record_latency(int64_t microseconds);
+    std::string stats_json() const;
+
+private:
+    ThreadPool& pool_;
+    Encoder encoder_;
+    LruCache<std::string, Magick::Blob> cache_;
+
+    std::mutex inflight_mutex_;
+    std::unordered_map<std::string, std::shared_future<BlobPtr>> inflight_;
+
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> misses_{ 0 };
+    std::atomic<uint64_t> coalesced_{ 0 };
+    LatencyStats latency_;
+};
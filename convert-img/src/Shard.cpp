@@ -0,0 +1,95 @@
+#include "Shard.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+    string relative_key(const string& path, const string& base) {
+        const filesystem::path full(path);
+        if (!base.empty()) {
+            const filesystem::path relative = full.lexically_normal().lexically_relative(filesystem::path(base).lexically_normal());
+            if (!relative.empty() && *relative.begin() != "..") return relative.generic_string();
+        }
+        return full.generic_string();
+    }
+
+    vector<size_t> select_by_size(const vector<string>& paths, const vector<string>& keys, const ShardSpec& spec) {
+        vector<uint64_t> sizes(paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            error_code ignored;
+            const auto size = filesystem::file_size(paths[i], ignored);
+            sizes[i] = size == static_cast<uintmax_t>(-1) ? 0 : size;
+        }
+
+        // Largest first, ties broken by path so every node computes the same order.
+        vector<size_t> order(paths.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+            return tie(sizes[b], keys[a]) < tie(sizes[a], keys[b]);
+        });
+
+        using Load = pair<uint64_t, size_t>;  // (bytes assigned, shard), smallest shard number wins ties
+        priority_queue<Load, vector<Load>, greater<Load>> loads;
+        for (size_t shard = 1; shard <= spec.count; shard++) loads.push({ 0, shard });
+
+        vector<size_t> selected;
+        for (const size_t i : order) {
+            Load lightest = loads.top();
+            loads.pop();
+            if (lightest.second == spec.index) selected.push_back(i);
+            lightest.first += max<uint64_t>(sizes[i], 1);
+            loads.push(lightest);
+        }
+        sort(selected.begin(), selected.end());
+        return selected;
+    }
+}
+
+ShardSpec shard::parse(const string& text) {
+    const size_t slash = text.find('/');
+    ShardSpec spec;
+    try {
+        if (slash == string::npos) throw invalid_argument("missing '/'");
+        size_t used = 0;
+        spec.index = stoul(text.substr(0, slash), &used);
+        if (used != slash) throw invalid_argument("bad index");
+        spec.count = stoul(text.substr(slash + 1), &used);
+        if (used != text.size() - slash - 1) throw invalid_argument("bad count");
+    }
+    catch (const exception&) {
+        throw invalid_argument("Invalid shard '" + text + "', expected i/N (e.g. 1/4)");
+    }
+    if (spec.count == 0 || spec.index == 0 || spec.index > spec.count) {
+        throw invalid_argument("Invalid shard '" + text + "', expected 1 <= i <= N");
+    }
+    return spec;
+}
+
+uint64_t shard::fnv1a(const string_view text) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+vector<size_t> shard::select(const vector<string>& paths, const string& base, const ShardSpec& spec) {
+    vector<string> keys;
+    keys.reserve(paths.size());
+    for (const auto& path : paths) keys.push_back(relative_key(path, base));
+
+    if (spec.balance_by_size) return select_by_size(paths, keys, spec);
+
+    vector<size_t> selected;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (fnv1a(keys[i]) % spec.count == spec.index - 1) selected.push_back(i);
+    }
+    return selected;
+}
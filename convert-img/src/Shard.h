@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// One node's slice of a batch split across machines. Every node enumerates the same inputs and keeps
+// only its own, so the split needs no coordination.
+struct ShardSpec {
+    size_t index = 1;  // 1-based
+    size_t count = 1;
+    bool balance_by_size = false;
+
+    bool enabled() const { return count > 1; }
+};
+
+namespace shard {
+    // Parses "i/N" with 1 <= i <= N. Throws std::invalid_argument otherwise.
+    ShardSpec parse(const std::string& text);
+
+    // 64-bit FNV-1a: stable across platforms, builds and runs, unlike std::hash.
+    uint64_t fnv1a(std::string_view text);
+
+    // Indices into `paths` that belong to `spec.index`, in their original order. Paths are hashed
+    // relative to `base` (with '/' separators) so nodes mounting the share elsewhere still agree.
+    // With `balance_by_size`, files are instead dealt largest first to the least loaded shard, which
+    // evens out per-node bytes at the cost of a size pre-scan.
+    std::vector<size_t> select(const std::vector<std::string>& paths, const std::string& base, const ShardSpec& spec);
+}  // namespace shard
@@ -0,0 +1,201 @@
+#include "Socket.h"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <afunix.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#define CLOSE_SOCKET closesocket
+#define SHUT_WR SD_SEND
+static const socket_handle invalid_socket = INVALID_SOCKET;
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <unistd.h>
+#define CLOSE_SOCKET ::close
+static const socket_handle invalid_socket = -1;
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  // only Linux raises SIGPIPE on writes to a closed peer
+#endif
+
+using namespace std;
+
+namespace {
+    void ensure_socket_library() {
+#ifdef _WIN32
+        static const bool initialized = [] {
+            WSADATA data;
+            return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        if (!initialized) throw runtime_error("WSAStartup failed");
+#endif
+    }
+
+    sockaddr_un make_unix_address(const string& path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) throw runtime_error("Socket path too long: " + path);
+        memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    // Classifies the error of the last failed accept() on this thread.
+    AcceptError accept_error() {
+#ifdef _WIN32
+        const int code = WSAGetLastError();
+        const bool exhausted = code == WSAEMFILE || code == WSAENOBUFS;
+        const bool retryable = exhausted || code == WSAEINTR || code == WSAECONNRESET || code == WSAEWOULDBLOCK;
+        return AcceptError("Failed to accept connection (error " + to_string(code) + ")", retryable, exhausted);
+#else
+        const int code = errno;
+        const bool exhausted = code == EMFILE || code == ENFILE || code == ENOBUFS || code == ENOMEM;
+        // Linux also reports pending network errors of the new connection through accept().
+        const bool retryable = exhausted || code == EINTR || code == EAGAIN || code == EWOULDBLOCK ||
+            code == ECONNABORTED || code == EPROTO || code == ENETDOWN || code == ENETUNREACH ||
+            code == EHOSTDOWN || code == EHOSTUNREACH || code == ENOPROTOOPT || code == EOPNOTSUPP;
+        return AcceptError("Failed to accept connection: " + string(strerror(code)), retryable, exhausted);
+#endif
+    }
+}  // namespace
+
+AcceptError::AcceptError(const string& message, const bool retryable, const bool exhausted)
+    : runtime_error(message), retryable_(retryable), exhausted_(exhausted) {}
+
+bool AcceptError::retryable() const {
+    return retryable_;
+}
+
+bool AcceptError::exhausted() const {
+    return exhausted_;
+}
+
+Socket::Socket() : handle_(invalid_socket) {}
+
+Socket::Socket(const socket_handle handle) : handle_(handle) {}
+
+Socket::~Socket() {
+    close();
+}
+
+Socket Socket::listen_unix(const string& path) {
+    ensure_socket_library();
+    const sockaddr_un address = make_unix_address(path);
+    remove(path.c_str());  // stale socket from a previous run
+
+    Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (!socket.valid()) throw runtime_error("Failed to create socket");
+    if (::bind(socket.handle_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        throw runtime_error("Failed to bind socket: " + path);
+    if (::listen(socket.handle_, SOMAXCONN) != 0) throw runtime_error("Failed to listen on socket: " + path);
+    return socket;
+}
+
+Socket Socket::connect_unix(const string& path) {
+    ensure_socket_library();
+    const sockaddr_un address = make_unix_address(path);
+
+    Socket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (!socket.valid()) throw runtime_error("Failed to create socket");
+    if (::connect(socket.handle_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+        throw runtime_error("Failed to connect to socket: " + path);
+    return socket;
+}
+
+Socket Socket::listen_tcp(const string& host, const uint16_t port) {
+    ensure_socket_library();
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), to_string(port).c_str(), &hints, &result) != 0)
+        throw runtime_error("Failed to resolve address: " + host);
+    const unique_ptr<addrinfo, decltype(&freeaddrinfo)> addresses(result, freeaddrinfo);
+
+    Socket socket(::socket(result->ai_family, result->ai_socktype, result->ai_protocol));
+    if (!socket.valid()) throw runtime_error("Failed to create socket");
+    const int reuse = 1;
+    setsockopt(socket.handle_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    if (::bind(socket.handle_, result->ai_addr, static_cast<int>(result->ai_addrlen)) != 0)
+        throw runtime_error("Failed to bind " + host + ":" + to_string(port));
+    if (::listen(socket.handle_, SOMAXCONN) != 0) throw runtime_error("Failed to listen on " + host + ":" + to_string(port));
+    return socket;
+}
+
+Socket Socket::accept() const {
+    Socket client(::accept(handle_, nullptr, nullptr));
+    if (!client.valid()) throw accept_error();
+    return client;
+}
+
+bool Socket::read_line(string& line) {
+    while (true) {
+        const size_t newline = buffer_.find('\n');
+        if (newline != string::npos) {
+            line = buffer_.substr(0, newline);
+            buffer_.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            return true;
+        }
+
+        char chunk[4096];
+        const auto received = ::recv(handle_, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            if (buffer_.empty()) return false;
+            line = std::move(buffer_);
+            buffer_.clear();
+            return true;
+        }
+        buffer_.append(chunk, static_cast<size_t>(received));
+    }
+}
+
+void Socket::write_all(const string& data) const {
+    write_all(data.data(), data.size());
+}
+
+void Socket::write_all(const void* data, const size_t size) const {
+    const char* bytes = static_cast<const char*>(data);
+    size_t sent = 0;
+    while (sent < size) {
+        const auto written = ::send(handle_, bytes + sent, static_cast<int>(size - sent), MSG_NOSIGNAL);
+        if (written <= 0) throw runtime_error("Failed to write to socket");
+        sent += static_cast<size_t>(written);
+    }
+}
+
+void Socket::shutdown_write() const {
+    ::shutdown(handle_, SHUT_WR);
+}
+
+void Socket::close() {
+    if (valid()) {
+        CLOSE_SOCKET(handle_);
+        handle_ = invalid_socket;
+    }
+}
+
+bool Socket::valid() const {
+    return handle_ != invalid_socket;
+}
+
+Socket::Socket(Socket&& other) noexcept : handle_(other.handle_), buffer_(std::move(other.buffer_)) {
+    other.handle_ = invalid_socket;
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept {
+    if (this != &other) {
+        close();
+        handle_ = other.handle_;
+        buffer_ = std::move(other.buffer_);
+        other.handle_ = invalid_socket;
+    }
+    return *this;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#include <winsock2.h>
+using socket_handle = SOCKET;
+#else
+using socket_handle = int;
+#endif
+
+// Thrown by Socket::accept. A retryable failure concerns one connection or a temporary shortage
+// (interrupted call, aborted handshake, out of descriptors) and leaves the listener usable; when
+// `exhausted()`, the process or system ran out of descriptors or buffers, so back off before retrying.
+class AcceptError : public std::runtime_error {
+public:
+    AcceptError(const std::string& message, bool retryable, bool exhausted);
+
+    bool retryable() const;
+    bool exhausted() const;
+
+private:
+    bool retryable_;
+    bool exhausted_;
+};
+
+// Minimal blocking stream socket (Unix domain or TCP) with buffered line reads.
+class Socket {
+public:
+    Socket();
+    explicit Socket(socket_handle handle);
+    ~Socket();
+
+    static Socket listen_unix(const std::string& path);
+    static Socket connect_unix(const std::string& path);
+    static Socket listen_tcp(const std::string& host, uint16_t port);
+
+    // Throws AcceptError.
+    Socket accept() const;
+
+    // Reads up to '\n' (stripped). Returns false on EOF before any data.
+    bool read_line(std::string& line);
+    void write_all(const std::string& data) const;
+    void write_all(const void* data, size_t size) const;
+    void shutdown_write() const;
+    void close();
+
+    bool valid() const;
+
+    Socket(Socket&& other) noexcept;
+    Socket& operator=(Socket&& other) noexcept;
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+
+private:
+    socket_handle handle_;
+    std::string buffer_;
+};
@@ -0,0 +1,202 @@
+#include "Tiles.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <Magick++.h>
+#include <spdlog/spdlog.h>
+
+#include "Progress.h"
+#include "convertimg/Converter.h"
+#include "convertimg/ThreadPool.h"
+#include "convertimg/Utils.h"
+
+using namespace std;
+
+namespace {
+    constexpr size_t band_rows = 64;  // output rows per downsampling task
+
+    // One level of the pyramid: the decoded source for the top level, 8-bit pixels for the others.
+    struct Level {
+        size_t width = 0;
+        size_t height = 0;
+        size_t channels = 3;
+        Magick::Image* source = nullptr;
+        vector<unsigned char> pixels;
+
+        // Copies the rectangle into `destination`, packed.
+        void region(const size_t x, const size_t y, const size_t w, const size_t h, unsigned char* destination) const {
+            if (source != nullptr) {
+                // Reads through a cache view of its own, so any number of threads can export at once.
+                source->write(static_cast<ssize_t>(x), static_cast<ssize_t>(y), w, h, channels == 4 ? "RGBA" : "RGB",
+                    Magick::CharPixel, destination);
+                return;
+            }
+            for (size_t row = 0; row < h; row++) {
+                memcpy(destination + row * w * channels, &pixels[((y + row) * width + x) * channels], w * channels);
+            }
+        }
+    };
+
+    // `next` is `level` halved (rounded up), each pixel the mean of the 2x2 block above it.
+    Level downsample(ThreadPool& pool, const Level& level) {
+        Level next;
+        next.width = (level.width + 1) / 2;
+        next.height = (level.height + 1) / 2;
+        next.channels = level.channels;
+        next.pixels.resize(next.width * next.height * next.channels);
+
+        const size_t c = level.channels;
+        const size_t bands = (next.height + band_rows - 1) / band_rows;
+        pool.parallel_for(bands, [&](const size_t band) {
+            const size_t first = band * band_rows;
+            const size_t last = min(next.height, first + band_rows);
+            const size_t source_first = first * 2;
+            const size_t source_rows = min(level.height, last * 2) - source_first;
+            vector<unsigned char> rows(source_rows * level.width * c);
+            level.region(0, source_first, level.width, source_rows, rows.data());
+
+            for (size_t y = first; y < last; y++) {
+                const unsigned char* top = &rows[(y * 2 - source_first) * level.width * c];
+                // The last row of an odd height is averaged with itself, and so is the last column.
+                const unsigned char* bottom = y * 2 + 1 < level.height ? top + level.width * c : top;
+                unsigned char* out = &next.pixels[y * next.width * c];
+                for (size_t x = 0; x < next.width; x++) {
+                    const size_t left = x * 2 * c;
+                    const size_t right = x * 2 + 1 < level.width ? left + c : left;
+                    for (size_t k = 0; k < c; k++) {
+                        out[x * c + k] = static_cast<unsigned char>((top[left + k] + top[right + k] + bottom[left + k] + bottom[right + k] + 2) / 4);
+                    }
+                }
+            }
+        });
+        return next;
+    }
+
+    bool is_background(const vector<unsigned char>& tile, const size_t channels, const unsigned char* background) {
+        const bool transparent = channels == 4 && background[3] == 0;
+        for (size_t i = 0; i < tile.size(); i += channels) {
+            if (transparent && tile[i + 3] == 0) continue;
+            if (memcmp(&tile[i], background, channels) != 0) return false;
+        }
+        return true;
+    }
+
+    size_t tile_count(const size_t length, const size_t size) {
+        return (length + size - 1) / size;
+    }
+}
+
+size_t tiles::build(ThreadPool& pool, const string& input_path, const string& output_dir,
+    const TileOptions& options, const bool live_progress)
+{
+    if (options.size == 0) throw runtime_error("Tile size must be at least 1 px");
+    const bool dzi = options.layout == "dzi";
+    if (!dzi && options.layout != "xyz") throw runtime_error("Unknown tile layout: " + utils::quote(options.layout));
+    const size_t overlap = dzi ? options.overlap : 0;
+
+    Magick::Image image;
+    try {
+        image.quiet(true);
+        image.subRange(1);
+        image.fileName(input_path);
+        image.read(read_blob(input_path));
+        image.colorSpace(Magick::sRGBColorspace);
+    }
+    catch (Magick::Exception& e) {
+        throw runtime_error("Magick++ exception: " + string(e.what()));
+    }
+
+    Level level;
+    level.width = image.columns();
+    level.height = image.rows();
+    level.channels = image.alpha() ? 4 : 3;
+    level.source = &image;
+    const size_t width = level.width, height = level.height;
+
+    string format = options.format;
+    if (format.empty()) format = level.channels == 4 ? "png" : "jpg";
+    if (!format.empty() && format[0] == '.') format.erase(0, 1);
+    unsigned char background[4] = { 0, 0, 0, 0 };
+    level.region(0, 0, 1, 1, background);
+
+    // DeepZoom goes down to 1x1; XYZ stops where the image fits a single tile, which is zoom 0.
+    size_t top = 0;
+    for (size_t longest = max(level.width, level.height); longest > (dzi ? 1 : options.size); longest = (longest + 1) / 2) top++;
+
+    size_t total = 0;
+    for (size_t l = 0, w = level.width, h = level.height; l <= top; l++, w = (w + 1) / 2, h = (h + 1) / 2) {
+        total += tile_count(w, options.size) * tile_count(h, options.size);
+    }
+
+    const string name = filesystem::path(input_path).stem().string();
+    const filesystem::path root = dzi ? filesystem::path(output_dir) / (name + "_files") : filesystem::path(output_dir);
+    spdlog::info("Tiling {} ({}x{}) into {} levels of {} px {} tiles under {}", utils::quote(input_path), level.width, level.height,
+        top + 1, options.size, format, utils::quote(root.string()));
+
+    ProgressReporter progress(total, live_progress);
+    atomic<size_t> written{ 0 }, skipped{ 0 };
+    for (size_t z = top + 1; z-- > 0;) {
+        const size_t columns = tile_count(level.width, options.size);
+        const size_t rows = tile_count(level.height, options.size);
+        const filesystem::path level_dir = root / to_string(z);
+        for (size_t col = 0; col < (dzi ? 1 : columns); col++) {
+            filesystem::create_directories(dzi ? level_dir : level_dir / to_string(col));
+        }
+
+        pool.parallel_for(columns * rows, [&](const size_t t) {
+            const size_t col = t % columns, row = t / columns;
+            const size_t x = col * options.size - (col != 0 ? overlap : 0);
+            const size_t y = row * options.size - (row != 0 ? overlap : 0);
+            const size_t w = min(level.width, (col + 1) * options.size + overlap) - x;
+            const size_t h = min(level.height, (row + 1) * options.size + overlap) - y;
+
+            vector<unsigned char> pixels(w * h * level.channels);
+            level.region(x, y, w, h, pixels.data());
+            if (options.skip_uniform && is_background(pixels, level.channels, background)) {
+                skipped++;
+                progress.add(true, 0, 0);
+                return;
+            }
+
+            const filesystem::path path = dzi
+                ? level_dir / (to_string(col) + "_" + to_string(row) + "." + format)
+                : level_dir / to_string(col) / (to_string(row) + "." + format);
+            Magick::Blob blob;
+            try {
+                Magick::Image tile(w, h, level.channels == 4 ? "RGBA" : "RGB", Magick::CharPixel, pixels.data());
+                tile.quality(options.quality);
+                tile.magick(format);
+                tile.write(&blob);
+            }
+            catch (Magick::Exception& e) {
+                throw runtime_error("Magick++ exception: " + string(e.what()));
+            }
+            write_blob(blob, path.string());
+            written++;
+            progress.add(true, 0, blob.length());
+        });
+
+        // Only this level and the next are held; the source is released once the first half is built.
+        if (z != 0) level = downsample(pool, level);
+        if (level.source == nullptr) image = Magick::Image();
+    }
+    progress.finish();
+
+    spdlog::info("Wrote {} tiles, skipped {} background tiles", written.load(), skipped.load());
+
+    if (dzi) {
+        const string descriptor = (filesystem::path(output_dir) / (name + ".dzi")).string();
+        ofstream xml(descriptor);
+        xml << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"" << format << "\" Overlap=\"" << overlap
+            << "\" TileSize=\"" << options.size << "\">\n"
+            << "  <Size Width=\"" << width << "\" Height=\"" << height << "\"/>\n"
+            << "</Image>\n";
+        if (!xml) throw runtime_error("Failed to write " + utils::quote(descriptor));
+    }
+    return written;
+}
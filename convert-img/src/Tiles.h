@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class ThreadPool;
+
+struct TileOptions {
+    std::string layout = "dzi";  // dzi: <name>.dzi + <name>_files/<level>/<col>_<row>; xyz: <z>/<x>/<y>
+    size_t size = 256;           // tile width and height, without the overlap
+    size_t overlap = 1;          // pixels shared with each neighbouring tile (DeepZoom only)
+    std::string format;          // tile format; empty: jpg, or png for images with alpha
+    int quality = 80;
+    bool skip_uniform = true;    // do not write tiles that are nothing but the background colour
+};
+
+// DeepZoom / XYZ tile pyramids for zoomable viewers of very large images.
+namespace tiles {
+    // Decodes `input_path` once and writes its tile pyramid under `output_dir`. Every level is the
+    // previous one downsampled 2x (box filter), so each level costs a quarter of the one above and
+    // only two levels are held at a time. Tiles are cut and encoded in parallel on `pool`. Tiles
+    // that only hold the background (the colour of the top-left pixel, or transparency) are left
+    // out when `skip_uniform` is set; viewers draw missing tiles as empty. Returns the number of tiles
+    // written.
+    size_t build(ThreadPool& pool, const std::string& input_path, const std::string& output_dir,
+        const TileOptions& options, bool live_progress);
+}  // namespace tiles
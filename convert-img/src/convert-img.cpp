@@ -2,202 +2,612 @@
 #include <filesystem>
 #include <CLI/CLI.hpp>
 #include <spdlog/spdlog.h>
-#include <spdlog/sinks/stdout_color_sinks.h>
 #include <Magick++.h>
+#include <nlohmann/json.hpp>
 #include <chrono>
 #include <thread>
 #include <future>
-
-#include "ThreadPool.h"
+#include <fstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+
+#include "Atlas.h"
+#include "Dedupe.h"
+#include "HttpServer.h"
+#include "Inventory.h"
+#include "JobManifest.h"
+#include "JobServer.h"
+#include "Journal.h"
+#include "Logging.h"
+#include "ProcessPool.h"
+#include "Progress.h"
+#include "ResizeService.h"
+#include "Shard.h"
+#include "Tiles.h"
+#include "convertimg/ColorProfile.h"
+#include "convertimg/ConvertEngine.h"
+#include "convertimg/PixelPool.h"
+#include "convertimg/StageStats.h"
+#include "convertimg/ThreadPool.h"
+#include "convertimg/Trace.h"
+#include "convertimg/Utils.h"
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 using namespace std;
 
 
-// Moved repetitive utility functions here to reduce redundancy
-namespace utils {
-    string quote(const string& str) {
-        return "\"" + str + "\"";
-    }
+namespace {
+    // The ConvertEngine or ProcessPool to cancel, and how to cancel it.
+    atomic<void*> interruptible_runner{ nullptr };
+    atomic<void (*)(void*)> cancel_runner{ nullptr };
+    atomic<bool> interrupted{ false };
 
-    bool is_file(const string& path) {
-        return filesystem::is_regular_file(path);
+    // First SIGINT/SIGTERM: stop starting jobs and let running ones finish. Second: exit immediately.
+    void on_interrupt(const int signal_number) {
+        if (interrupted.exchange(true)) std::_Exit(130);
+        signal(signal_number, on_interrupt);  // some platforms reset the handler on delivery
+        if (void* runner = interruptible_runner.load()) cancel_runner.load()(runner);
     }
 
-    bool is_directory(const string& path)
-    {
-    	return filesystem::is_directory(path);
-	}
+    // Routes SIGINT/SIGTERM to `runner` for as long as it is in scope.
+    template<class Runner>
+    struct InterruptScope {
+        explicit InterruptScope(Runner& runner) {
+            cancel_runner = [](void* target) { static_cast<Runner*>(target)->cancel(); };
+            interruptible_runner = &runner;
+            signal(SIGINT, on_interrupt);
+            signal(SIGTERM, on_interrupt);
+        }
+        ~InterruptScope() {
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            interruptible_runner = nullptr;
+        }
+    };
 
-    string get_extension(const string& path) {
-        return filesystem::path(path).extension().string();
+    // When resuming, a job is done if the journal lists it or, without --force, if its output exists:
+    // outputs are renamed into place only once complete, but the journal may lag by one sync interval.
+    bool already_done(const Journal* journal, const string& input_path, const string& output_path, const bool overwrite) {
+        if (journal == nullptr || !journal->resuming()) return false;
+        return journal->completed(input_path, output_path) || (!overwrite && utils::is_file(output_path));
     }
 
-    vector<string> get_files(const string& path, const string& ext)
-	{
-        vector<string> files;
-        for (const auto& entry : filesystem::directory_iterator(path)) 
-        {
-            const string& file_path = entry.path().string();
-            if (is_file(file_path) && (ext.empty() || get_extension(file_path) == ext)) 
-            {
-                files.push_back(file_path);
-            }
+    // Keeps the entries of `items` that belong to this node's shard.
+    template<class T, class Path>
+    void keep_shard(vector<T>& items, const string& base, const ShardSpec& spec, Path path_of) {
+        if (!spec.enabled()) return;
+        vector<string> paths;
+        paths.reserve(items.size());
+        for (const auto& item : items) paths.push_back(path_of(item));
+
+        vector<T> mine;
+        for (const size_t i : shard::select(paths, base, spec)) mine.push_back(std::move(items[i]));
+        spdlog::info("Shard {}/{}: {} of {} inputs", spec.index, spec.count, mine.size(), items.size());
+        items = std::move(mine);
+    }
+
+    // Largest estimated cost first, so the biggest files do not start last and stretch the tail of the
+    // batch. Files the inventory does not list keep their order, after the listed ones.
+    template<class T, class Path>
+    void order_by_cost(vector<T>& items, const CostTable& costs, Path path_of) {
+        vector<uint64_t> cost(items.size());
+        size_t unknown = 0;
+        for (size_t i = 0; i < items.size(); i++) {
+            cost[i] = costs.cost(path_of(items[i]));
+            if (cost[i] == 0) unknown++;
         }
-        return files;
+        vector<size_t> order(items.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+        stable_sort(order.begin(), order.end(), [&cost](const size_t a, const size_t b) { return cost[a] > cost[b]; });
+
+        vector<T> ordered;
+        ordered.reserve(items.size());
+        for (const size_t i : order) ordered.push_back(std::move(items[i]));
+        items = std::move(ordered);
+        spdlog::info("Ordered {} jobs by inventory cost ({} not in the inventory)", items.size(), unknown);
+    }
+
+    void report_interrupted(const size_t cancelled) {
+        if (cancelled != 0) spdlog::warn("Interrupted: {} job(s) were not started. Run again with --resume to finish them", cancelled);
     }
-}  // namespace utils
-
-enum class CompressionMode {
-    Lossy,
-    Lossless,
-    None
-};
-
-CompressionMode get_compression_mode(const string& mode) {
-    if (mode == "lossy") return CompressionMode::Lossy;
-    if (mode == "lossless") return CompressionMode::Lossless;
-    return CompressionMode::None;
 }
 
-void set_compression(Magick::Image& image, const string& output_ext, const CompressionMode mode) {
-    if (mode == CompressionMode::None) return;
+// `Runner` is a ConvertEngine or a ProcessPool.
+template<class Runner>
+void convert_images(
+    Runner& engine,
+    const string& input_dir, const string& output_dir,
+    const string& input_ext, const string& output_ext,
+    const CompressionMode compression, const int quality,
+    const double scale, const bool overwrite, const bool live_progress,
+    Journal* journal, const ShardSpec& shard, const CostTable* costs, const DedupeOptions& dedupe)
+{
+    vector<string> files;
+    {
+        ScopedStage stage(Stage::Enumerate);
+        files = utils::get_files(input_dir, input_ext);
+    }
+    keep_shard(files, input_dir, shard, [](const string& path) { return path; });
+
+    if (files.empty()) {
+        spdlog::warn("No files found in input directory: {}", utils::quote(input_dir));
+        return;
+    }
+    if (dedupe.enabled()) files = dedupe::filter(files, dedupe);
 
-    if (output_ext == ".png") {
-        // Magick++ doesn't have a direct lossy compression for PNG.
-        if (mode == CompressionMode::Lossy)
-        {
-        	spdlog::warn("Lossy compression is not supported for PNG. Using lossless compression instead.");
-		}
-        image.compressType(Magick::LZWCompression);
+    vector<ConvertJob> jobs;
+    jobs.reserve(files.size());
+    for (const auto& input_path : files) {
+        ConvertJob job;
+        job.input_path = input_path;
+        job.output_path = make_output_path(input_path, output_dir, output_ext);
+        job.quality = quality;
+        job.compression = compression;
+        job.scale = scale;
+        job.overwrite = overwrite;
+        if (!already_done(journal, job.input_path, job.output_path, overwrite)) jobs.push_back(std::move(job));
     }
-    else if (output_ext == ".jpeg" || output_ext == ".jpg")
-    {
-    	if (mode == CompressionMode::Lossless)
-    	{
-    		spdlog::warn("Lossless compression is not supported for JPEG. Using lossy compression instead.");
-    	}
-    	image.compressType(Magick::JPEGCompression);
+    if (jobs.size() != files.size()) spdlog::info("Resuming: {} of {} files are already converted", files.size() - jobs.size(), files.size());
+    if (costs != nullptr) order_by_cost(jobs, *costs, [](const ConvertJob& job) { return job.input_path; });
+
+    ProgressReporter progress(jobs.size(), live_progress);
+    atomic<size_t> cancelled{ 0 };
+    for (auto& job : jobs) {
+        engine.submit(std::move(job), [&](const ConvertJob& completed, ConvertResult& result) {
+            if (result.cancelled) {
+                cancelled++;
+                return;
+            }
+            if (!result.ok) spdlog::error("Failed to convert {}: {}", utils::quote(completed.input_path), result.error);
+            else if (journal != nullptr) journal->record(completed.input_path, completed.output_path);
+            progress.add(result.ok, result.input_bytes, result.output_bytes);
+        });
     }
-    else if (output_ext == ".tiff" || output_ext == ".tif") {
-        if (mode == CompressionMode::Lossy) {
-            image.compressType(Magick::JPEGCompression);
-        }
-        else if (mode == CompressionMode::Lossless) {
-            image.compressType(Magick::LZWCompression);
+    engine.wait();
+    progress.finish();
+    report_interrupted(cancelled);
+}
+
+// Logs the per-format stage latency breakdown and, when `json_path` is set, writes it there as JSON.
+void report_stage_stats(const bool print, const string& json_path) {
+    const vector<StageSummary> summaries = stats::snapshot();
+    const auto ms = [](const uint64_t micros) { return micros / 1000.0; };
+
+    if (print) {
+        spdlog::info("{:<8} {:<10} {:>8} {:>10} {:>10} {:>10} {:>10}", "format", "stage", "count", "p50 ms", "p90 ms", "p99 ms", "max ms");
+        for (const auto& summary : summaries) {
+            const Histogram& h = summary.histogram;
+            spdlog::info("{:<8} {:<10} {:>8} {:>10.2f} {:>10.2f} {:>10.2f} {:>10.2f}",
+                summary.format.empty() ? "-" : summary.format, stage_name(summary.stage), h.count(),
+                ms(h.percentile(0.5)), ms(h.percentile(0.9)), ms(h.percentile(0.99)), ms(h.max()));
         }
     }
-    else if (output_ext == ".webp") {
-        if (mode == CompressionMode::Lossy) {
-            image.compressType(Magick::JPEGCompression);
-        }
-        else if (mode == CompressionMode::Lossless) {
-            image.compressType(Magick::LZWCompression);
+
+    if (!json_path.empty()) {
+        nlohmann::json stages = nlohmann::json::array();
+        for (const auto& summary : summaries) {
+            const Histogram& h = summary.histogram;
+            stages.push_back({ { "format", summary.format }, { "stage", stage_name(summary.stage) }, { "count", h.count() },
+                { "mean_ms", h.mean() / 1000.0 }, { "p50_ms", ms(h.percentile(0.5)) }, { "p90_ms", ms(h.percentile(0.9)) },
+                { "p99_ms", ms(h.percentile(0.99)) }, { "max_ms", ms(h.max()) } });
         }
+        ofstream file(json_path);
+        file << nlohmann::json{ { "stages", stages } }.dump(2) << '\n';
+        if (!file) throw runtime_error("Failed to write stats: " + utils::quote(json_path));
     }
-    else if (output_ext == ".heif")
-    {
-	    if (mode == CompressionMode::Lossy)
-	    {
-	    	image.compressType(Magick::JPEGCompression);
-		}
-        else if (mode == CompressionMode::Lossless)
-        {
-        	image.compressType(Magick::LZWCompression);
-		}
-    }
-    else
-    {
-    	spdlog::warn("Compression mode is not supported for {} files. Using LZW compression (default) instead.", output_ext);
-	}
 }
 
-string get_new_path(const string& base_path) {
-    string new_path = base_path;
-    int count = 1;
-    while (filesystem::exists(new_path))
-    {
-        new_path = base_path.substr(0, base_path.find_last_of('.')) + "_" + to_string(count) + base_path.substr(base_path.find_last_of('.'));
-        count++;
+// Runs every manifest job on one shared pool and appends a JSON result line per job to `result_path`
+// as it completes. Returns the number of failed jobs.
+template<class Runner>
+size_t convert_manifest(
+    Runner& engine,
+    const string& manifest_path, const string& result_path, const string& output_dir,
+    const string& output_ext, const string& compression, const int quality,
+    const double scale, const bool overwrite, const bool live_progress,
+    Journal* journal, const ShardSpec& shard, const CostTable* costs)
+{
+    vector<ManifestJob> jobs = read_manifest(manifest_path);
+    spdlog::info("Loaded {} jobs from {}", jobs.size(), utils::quote(manifest_path));
+    keep_shard(jobs, "", shard, [](const ManifestJob& job) { return job.input; });
+    if (costs != nullptr) order_by_cost(jobs, *costs, [](const ManifestJob& job) { return job.input; });
+
+    ofstream results(result_path, ios::app);
+    if (!results) throw runtime_error("Failed to open job results: " + utils::quote(result_path));
+    mutex results_mutex;
+    atomic<size_t> failed{ 0 };
+
+    const auto write_result = [&](const nlohmann::json& result) {
+        lock_guard<mutex> lock(results_mutex);
+        results << result.dump() << '\n';
+    };
+
+    ProgressReporter progress(jobs.size(), live_progress);
+    atomic<size_t> cancelled{ 0 };
+    size_t skipped = 0;
+    for (const auto& entry : jobs) {
+        ConvertJob job;
+        job.input_path = entry.input;
+        job.format = entry.format.empty() || entry.format[0] != '.' ? entry.format : entry.format.substr(1);
+        job.output_path = entry.output;
+        job.quality = entry.quality.value_or(quality);
+        job.compression = get_compression_mode(entry.compression.empty() ? compression : entry.compression);
+        job.scale = entry.scale.value_or(scale);
+        job.overwrite = overwrite;
+
+        const size_t line = entry.line;
+        if (job.output_path.empty()) {
+            if (output_dir.empty()) {
+                write_result({ { "line", line }, { "input", job.input_path }, { "status", "error" },
+                    { "error", "no output and no output directory given" } });
+                failed++;
+                progress.add(false, 0, 0);
+                continue;
+            }
+            job.output_path = make_output_path(job.input_path, output_dir, !job.format.empty() ? job.format : output_ext);
+        }
+        if (already_done(journal, job.input_path, job.output_path, overwrite)) {
+            skipped++;
+            progress.add(true, 0, 0);
+            continue;
+        }
+
+        engine.submit(std::move(job), [&, line](const ConvertJob& completed, ConvertResult& result) {
+            if (result.cancelled) {
+                cancelled++;
+                return;
+            }
+            if (result.ok && journal != nullptr) journal->record(completed.input_path, completed.output_path);
+            nlohmann::json line_result = { { "line", line }, { "input", completed.input_path } };
+            if (result.ok) {
+                line_result["status"] = "ok";
+                line_result["output"] = result.output_path;
+            }
+            else {
+                line_result["status"] = "error";
+                line_result["error"] = result.error;
+                failed++;
+                spdlog::error("Job on line {} failed: {}", line, result.error);
+            }
+            line_result["ms"] = result.milliseconds;
+            write_result(line_result);
+            progress.add(result.ok, result.input_bytes, result.output_bytes);
+        });
     }
-    return new_path;
+    engine.wait();
+    progress.finish();
+    if (skipped != 0) spdlog::info("Resumed: skipped {} job(s) that were already done", skipped);
+    report_interrupted(cancelled);
+    results.flush();
+    return failed;
 }
 
-void convert_image(
+// Daemon wire format: one tab-separated job per line, one reply line per job.
+//   request: job <input> <output> <quality> <compression> <scale> <overwrite>
+//   reply:   ok <input> <written output> <milliseconds> | error <input> <message>
+string encode_job(
     const string& input_path, const string& output_path,
-    const int quality, const CompressionMode compression,
+    const int quality, const string& compression,
     const double scale, const bool overwrite)
 {
-    spdlog::info("Converting image: {} -> {}", utils::quote(input_path), utils::quote(output_path));
-
-    try 
-    {
-        Magick::Image image(input_path);
-        image.scale(Magick::Geometry(image.columns() * scale, image.rows() * scale));
-        image.quality(quality);
-
-    	set_compression(image, utils::get_extension(output_path), compression);
+    return "job\t" + input_path + "\t" + output_path + "\t" + to_string(quality) + "\t" + compression + "\t" +
+        to_string(scale) + "\t" + (overwrite ? "1" : "0");
+}
 
-        const string output_path_to_use = overwrite ? output_path : get_new_path(output_path);
-        image.write(output_path_to_use);
+string run_job(const string& request) {
+    const vector<string> fields = utils::split(request, '\t');
+    if (fields.size() != 7 || fields[0] != "job") return "error\t\tMalformed request";
+
+    ConvertJob job;
+    job.input_path = fields[1];
+    job.output_path = fields[2];
+    try {
+        job.quality = stoi(fields[3]);
+        job.compression = get_compression_mode(fields[4]);
+        job.scale = stod(fields[5]);
     }
-    catch (Magick::Exception& e) {
-        throw runtime_error("Magick++ exception: " + string(e.what()));
+    catch (const exception&) {
+        return "error\t" + fields[1] + "\tMalformed request";
     }
+    job.overwrite = fields[6] == "1";
+
+    const ConvertResult result = ConvertEngine::convert(job);
+    if (!result.ok) return "error\t" + fields[1] + "\t" + result.error;
+    return "ok\t" + fields[1] + "\t" + result.output_path + "\t" + to_string(result.milliseconds);
 }
 
-void convert_images(
-    const string& input_dir, const string& output_dir,
+// Sends the conversion to a running `--serve` daemon. Returns the number of failed jobs.
+size_t submit_to_daemon(
+    const string& socket_path, const string& input_path, const string& output_path,
     const string& input_ext, const string& output_ext,
-    const CompressionMode compression, const int quality,
-    const double scale, const bool overwrite, const int thread_count)
+    const string& compression, const int quality,
+    const double scale, const bool overwrite)
 {
-    const vector<string> files = utils::get_files(input_dir, input_ext);
+    // The daemon has its own working directory, so only absolute paths are meaningful to it.
+    vector<string> requests;
+    if (utils::is_file(input_path)) {
+        requests.push_back(encode_job(filesystem::absolute(input_path).string(), filesystem::absolute(output_path).string(),
+            quality, compression, scale, overwrite));
+    }
+    else {
+        filesystem::create_directories(output_path);
+        for (const auto& file : utils::get_files(input_path, input_ext)) {
+            requests.push_back(encode_job(filesystem::absolute(file).string(),
+                filesystem::absolute(make_output_path(file, output_path, output_ext)).string(),
+                quality, compression, scale, overwrite));
+        }
+    }
 
-    if (files.empty()) {
-        spdlog::warn("No files found in input directory: {}", utils::quote(input_dir));
-        return;
+    size_t failed = 0;
+    const size_t replies = job_client::submit(socket_path, requests, [&](const string& reply) {
+        const vector<string> fields = utils::split(reply, '\t');
+        if (fields.size() == 4 && fields[0] == "ok") {
+            spdlog::debug("Converted {} -> {} ({} ms)", utils::quote(fields[1]), utils::quote(fields[2]), fields[3]);
+        }
+        else {
+            spdlog::error("Failed {}: {}", fields.size() > 1 ? utils::quote(fields[1]) : "", fields.size() > 2 ? fields[2] : reply);
+            failed++;
+        }
+    });
+    if (replies < requests.size()) {
+        spdlog::error("Daemon closed the connection after {} of {} jobs", replies, requests.size());
+        failed += requests.size() - replies;
     }
+    return failed;
+}
 
-    ThreadPool pool(thread_count);
-    for (const auto& input_path : files) {
-        pool.enqueue([&] {
-            const filesystem::path input_p(input_path);
-            string input_filename = input_p.filename().string();
-            input_filename = input_filename.substr(0, input_filename.find_last_of('.'));
-
-            const string output_path = output_dir + input_filename + "." + output_ext;
-            convert_image(input_path, output_path, quality, compression, scale, overwrite);
-            });
+// `-` as input or output: the whole stream is buffered in memory and never touches the disk.
+string read_stream(FILE* stream) {
+    string data;
+    char chunk[1 << 16];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), stream)) > 0) data.append(chunk, read);
+    if (ferror(stream)) throw runtime_error("Failed to read from stdin");
+    return data;
+}
+
+void write_stream(FILE* stream, const Magick::Blob& blob) {
+    if (fwrite(blob.data(), 1, blob.length(), stream) != blob.length() || fflush(stream) != 0) {
+        throw runtime_error("Failed to write to stdout");
     }
 }
 
+// Serves `GET /img/<path>?w=<width>&fmt=<format>&q=<quality>` relative to `root`, and `GET /stats`.
+// Output formats the HTTP server encodes. Anything else would expose every ImageMagick coder to
+// the network, including ones that read or write files (txt, info, msl, ephemeral, ...).
+bool is_served_format(const string& format) {
+    static const array<const char*, 7> served = { "jpg", "jpeg", "png", "webp", "gif", "avif", "jxl" };
+    return find(served.begin(), served.end(), format) != served.end();
+}
 
-int main(int argc, char** argv)
+void serve_http(
+    ConvertEngine& engine,
+    const string& address, const string& root, const size_t cache_bytes,
+    const int default_quality, const CompressionMode compression)
 {
-    const auto console = spdlog::stdout_color_mt("console");
-    console->set_pattern("[%^%l%$] %v");
-    spdlog::set_default_logger(console);
-    Magick::InitializeMagick(nullptr);  // Moved initialization here
+    const size_t colon = address.rfind(':');
+    if (colon == string::npos) throw invalid_argument("Expected <host>:<port>, got " + address);
+    const string host = address.substr(0, colon);
+    const auto port = static_cast<uint16_t>(stoi(address.substr(colon + 1)));
+    const filesystem::path root_path = filesystem::canonical(root);
+
+    ResizeService service(engine.pool(), cache_bytes, [compression](const ResizeRequest& request) {
+        ConvertJob job;
+        job.input_path = request.path;
+        job.format = request.format;
+        job.quality = request.quality;
+        job.compression = compression;
+        job.max_width = request.width;
+        ConvertResult result = ConvertEngine::convert(job);
+        if (!result.ok) throw runtime_error(result.error);
+        return std::move(result.output);
+    });
+
+    HttpServer(host, port, [&](const HttpRequest& http_request) {
+        if (http_request.path == "/stats") {
+            HttpResponse response = HttpResponse::text(200, service.stats_json());
+            response.content_type = "application/json";
+            return response;
+        }
+        const string prefix = "/img/";
+        if (http_request.path.rfind(prefix, 0) != 0) return HttpResponse::text(404, "Not found");
+
+        const auto start = chrono::steady_clock::now();
 
+        // Resolve inside the root so `..` segments cannot escape it.
+        error_code error;
+        const filesystem::path source = filesystem::weakly_canonical(root_path / http_request.path.substr(prefix.size()), error);
+        const string relative = error ? "" : source.lexically_relative(root_path).string();
+        if (relative.empty() || relative.rfind("..", 0) == 0 || !utils::is_file(source.string())) {
+            return HttpResponse::text(404, "Not found");
+        }
+
+        ResizeRequest request;
+        request.path = source.string();
+        request.format = utils::get_extension(request.path);
+        if (!request.format.empty()) request.format.erase(0, 1);
+        request.quality = default_quality;
+        try {
+            const auto& query = http_request.query;
+            if (query.count("w")) request.width = stoul(query.at("w"));
+            if (query.count("fmt")) request.format = query.at("fmt");
+            if (query.count("q")) request.quality = clamp(stoi(query.at("q")), 1, 100);
+        }
+        catch (const exception&) {
+            return HttpResponse::text(400, "Invalid query parameter");
+        }
+        transform(request.format.begin(), request.format.end(), request.format.begin(),
+            [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        if (!is_served_format(request.format)) return HttpResponse::text(400, "Unsupported output format");
+
+        error_code size_error, time_error;
+        request.size = filesystem::file_size(source, size_error);
+        const auto modified = filesystem::last_write_time(source, time_error);
+        if (size_error || time_error) return HttpResponse::text(404, "Not found");
+        request.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+
+        const ResizeService::BlobPtr blob = service.fetch(request);
+
+        HttpResponse response;
+        response.owner = blob;
+        response.data = blob->data();
+        response.size = blob->length();
+        response.content_type = "application/octet-stream";
+        try {
+            const string mime = Magick::CoderInfo(request.format).mimeType();
+            if (!mime.empty()) response.content_type = mime;
+        }
+        catch (const Magick::Exception&) {}
+
+        service.record_latency(chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count());
+        return response;
+    }).run();
+}
+
+
+int main(int argc, char** argv)
+{
     CLI::App app{ "Image Conversion Tool (Convert, Scale, Resize)" };
     string input_path, output_path, input_ext, output_ext, compression_mode;
     int quality = 80;
     double scale = 1.0;
     bool overwrite = false;
     unsigned int num_threads = std::thread::hardware_concurrency(); // Default: number of available CPU cores
-
-    app.add_option("input", input_path, "Input image path")->required();
-    app.add_option("output", output_path, "Output image path")->required();
+    string limit_memory, limit_map, limit_disk, limit_area;
+    string serve_socket, connect_socket;
+    string http_address, cache_size = "256MiB";
+    string out_format;
+    string jobs_path, jobs_result;
+    bool print_stats = false;
+    string stats_json;
+    string trace_path;
+    bool verbose = false;
+    LoggingOptions log_options;
+    string journal_path;
+    string inventory_path, costs_path;
+    DedupeOptions dedupe;
+    string atlas_path;
+    AtlasOptions atlas_options;
+    string tiles_path;
+    TileOptions tile_options;
+    bool keep_uniform_tiles = false;
+    string target_profile, rendering_intent = "perceptual";
+    string shard_text, shard_by = "hash";
+    bool resume = false;
+    string log_file_size = "10MiB";
+    bool numa = false;
+    bool use_pixel_pool = false, huge_pages = false;
+    string pixel_pool_idle = "1GiB";
+    unsigned int processes = 0;
+    uint64_t recycle_after = 1000;
+    string recycle_rss = "2GiB";
+    string worker_ring;
+    size_t worker_index = 0;
+
+    app.add_option("input", input_path, "Input image path (`-` reads from stdin)");
+    app.add_option("output", output_path, "Output image path (`-` writes to stdout)");
     app.add_option("-q,--quality", quality, "Output image quality (1-100)")->check(CLI::Range(1, 100));
     app.add_option("-c,--compression", compression_mode, "Compression methods (lossy, lossless)");
     app.add_option("-s,--scale", scale, "Output image scale (0.1-1.0)")->check(CLI::Range(0.1, 1.0));
     app.add_option("-i,--in-ext", input_ext, "Input image extension");
     app.add_option("-o,--out-ext", output_ext, "Output image extension");
+    app.add_option("--jobs", jobs_path, "Run the jobs listed in a JSONL/CSV manifest (input, output, quality, scale, format, compression)");
+    app.add_option("--jobs-result", jobs_result, "Where to append per-job result lines (default: <manifest>.results.jsonl)");
+    const auto journal_option = app.add_option("--journal", journal_path, "Record completed jobs in this file so an interrupted batch can be resumed");
+    app.add_flag("--resume", resume, "Skip the jobs the --journal file lists as completed")->needs(journal_option);
+    app.add_option("--shard", shard_text, "Only convert this node's share i/N (1-based) of the inputs, for splitting a batch across machines");
+    app.add_option("--shard-by", shard_by, "How inputs are split between shards: hash (of the relative path) or size (balances bytes)")
+        ->check(CLI::IsMember({ "hash", "size" }));
+    app.add_option("--inventory", inventory_path, "Instead of converting, write format, size, depth, colorspace, alpha and frame count of every input to this CSV");
+    app.add_option("--costs", costs_path, "Start the most expensive inputs first, by the pixel counts of an --inventory report");
+    app.add_option("--atlas", atlas_path, "Instead of converting, thumbnail every input into one sprite sheet with a JSON map of where each one is");
+    app.add_option("--atlas-tile", atlas_options.tile, "Largest thumbnail width and height in the atlas, in pixels")->check(CLI::Range(1, 65536));
+    app.add_option("--atlas-width", atlas_options.max_width, "Widest atlas, in pixels")->check(CLI::Range(1, 65536));
+    app.add_option("--atlas-padding", atlas_options.padding, "Transparent pixels between atlas thumbnails");
+    app.add_option("--target-profile", target_profile, "Convert every image from its embedded ICC profile to this one (e.g. sRGB.icc) and embed it");
+    app.add_option("--intent", rendering_intent, "Rendering intent of --target-profile (perceptual, relative, saturation, absolute)")
+        ->check(CLI::IsMember({ "perceptual", "relative", "saturation", "absolute" }));
+    app.add_option("--tiles", tiles_path, "Instead of converting, write a DeepZoom/XYZ tile pyramid of the input image to this directory");
+    app.add_option("--tile-layout", tile_options.layout, "Tile pyramid layout: dzi (DeepZoom) or xyz (<z>/<x>/<y>)")
+        ->check(CLI::IsMember({ "dzi", "xyz" }));
+    app.add_option("--tile-size", tile_options.size, "Tile width and height in pixels")->check(CLI::Range(1, 65536));
+    app.add_option("--tile-overlap", tile_options.overlap, "Pixels each DeepZoom tile shares with its neighbours");
+    app.add_flag("--tiles-keep-uniform", keep_uniform_tiles, "Also write tiles that are nothing but background");
+    app.add_flag("--dedupe", dedupe.skip_duplicates, "Convert only the largest file of each group of near-duplicate images (by perceptual hash)");
+    app.add_option("--dedupe-report", dedupe.report_path, "Write every input's near-duplicate cluster and representative to this CSV");
+    app.add_option("--dedupe-distance", dedupe.max_distance, "Differing hash bits (of 64) that still count as a near-duplicate (0-16)")
+        ->check(CLI::Range(0, 16));
+    app.add_option("--out-format", out_format, "Output format when writing to stdout (default: same as input)");
+    app.add_flag("--stats", print_stats, "Print p50/p90/p99 latency per format and stage (read, decode, resize, encode, write)");
+    app.add_option("--stats-json", stats_json, "Write the per-format stage latency breakdown to this JSON file");
+    app.add_option("--trace", trace_path, "Record a timeline of every job stage per thread to this Chrome trace-event JSON file");
     app.add_option("-t,--threads", num_threads, "Number of threads to use");
+    app.add_flag("--numa", numa, "Pin worker threads per NUMA node with a job queue per node; nodes only take each other's jobs once their own run out");
+    app.add_option("--processes", processes, "Convert batches in this many worker processes instead of threads, isolating coder crashes and leaks");
+    app.add_option("--recycle-after", recycle_after, "Replace a worker process after this many jobs (0: never)");
+    app.add_option("--recycle-rss", recycle_rss, "Replace a worker process once its resident memory grew by this much (e.g. 2GiB; 0: never)");
+    app.add_option("--worker", worker_ring, "Internal: run as a worker process of --processes")->group("");
+    app.add_option("--worker-index", worker_index, "Internal: index of this worker process")->group("");
     app.add_flag("-f,--force", overwrite, "Overwrite existing file");
+    app.add_flag("-v,--verbose", verbose, "Log every file instead of a progress line");
+    const auto log_level_option = app.add_option("--log-level", log_options.level, "Log level (trace, debug, info, warn, error, critical, off)")
+        ->check(CLI::IsMember({ "trace", "debug", "info", "warn", "error", "critical", "off" }));
+    app.add_option("--log-file", log_options.file, "Also write the log to this file, rotated by size");
+    app.add_option("--log-file-size", log_file_size, "Size at which the log file is rotated (e.g. 10MiB); 3 files are kept");
+    app.add_option("--limit-memory", limit_memory, "Pixel cache heap limit (e.g. 4GiB). Default: derived from cgroup/physical memory");
+    app.add_option("--limit-map", limit_map, "Pixel cache memory-map limit (e.g. 8GiB)");
+    app.add_option("--limit-disk", limit_disk, "Pixel cache disk limit (e.g. 16GiB)");
+    app.add_option("--limit-area", limit_area, "Largest image area (pixels) kept in memory per job");
+    app.add_flag("--pixel-pool", use_pixel_pool, "Recycle ImageMagick's large buffers (pixel caches) through a size-class pool instead of the system allocator");
+    app.add_option("--pixel-pool-idle", pixel_pool_idle, "Freed buffers the pixel pool keeps for reuse (e.g. 1GiB)");
+    app.add_flag("--huge-pages", huge_pages, "Back pixel pool buffers of 2 MiB and up with transparent huge pages (Linux)");
+    app.add_option("--serve", serve_socket, "Run as a daemon accepting jobs on this Unix domain socket");
+    app.add_option("--connect", connect_socket, "Submit the conversion to a daemon listening on this socket");
+    app.add_option("--http", http_address, "Serve resized variants of files under <input> over HTTP on <host>:<port>");
+    app.add_option("--cache-size", cache_size, "Byte budget of the HTTP server's encoded output cache (e.g. 256MiB)");
 
     CLI11_PARSE(app, argc, argv);
 
+    if (verbose && log_level_option->count() == 0) log_options.level = "debug";
+    // Keep stdout clean for the encoded image.
+    log_options.to_stderr = output_path == "-";
+    try {
+        log_options.file_size = resources::parse_size(log_file_size);
+        logging::setup(log_options);
+    }
+    catch (const exception& e) {
+        cerr << "Failed to set up logging: " << e.what() << endl;
+        return 1;
+    }
+    // Declared after the setup so every other local (and its log output) is gone before the queue is drained.
+    struct LoggingGuard {
+        ~LoggingGuard() { logging::shutdown(); }
+    } logging_guard;
+
+    if (!target_profile.empty()) {
+        try {
+            color::set_target_profile(target_profile, rendering_intent);
+        }
+        catch (const exception& e) {
+            spdlog::error("{}", e.what());
+            return 1;
+        }
+    }
+
+    if (!worker_ring.empty()) return process_pool::run_worker(worker_ring, worker_index);
+
+    if (serve_socket.empty() && jobs_path.empty() && (input_path.empty() || (output_path.empty() && http_address.empty() && inventory_path.empty() && atlas_path.empty() && tiles_path.empty()))) {
+        spdlog::error("Input and output paths are required");
+        return 1;
+    }
+
     try 
     {
 	    std::chrono::time_point<chrono::steady_clock> start;
@@ -206,30 +616,97 @@ int main(int argc, char** argv)
         // remove `.` from out extensions if present
         if (output_ext[0] == '.') output_ext.erase(0, 1);
         // add `.` to in extensions if not present
-        if (input_ext[0] != '.') input_ext.insert(0, 1, '.');
+        if (!input_ext.empty() && input_ext[0] != '.') input_ext.insert(0, 1, '.');
 
 	    const CompressionMode comp_mode = get_compression_mode(compression_mode);
         if (comp_mode == CompressionMode::None && (output_ext == ".tif" || output_ext == ".tiff")) {
             spdlog::warn("Please use '-c' or '--compression' to specify different compression methods for .tiff format in order to change image quality.");
         }
-        if (utils::is_file(input_path)) 
-        {
-            start = std::chrono::high_resolution_clock::now();
-            if (utils::get_extension(output_path) == "tiff" && quality != 95) spdlog::warn("Quality is ignored for tiff files");
-            convert_image(input_path, output_path, quality, comp_mode, scale, overwrite);
-            end = std::chrono::high_resolution_clock::now();
+        // The client only ships paths, so it skips Magick initialization entirely.
+        if (!connect_socket.empty()) {
+            const size_t failed = submit_to_daemon(connect_socket, input_path, output_path, input_ext, output_ext,
+                compression_mode, quality, scale, overwrite);
+            return failed == 0 ? 0 : 1;
         }
-        else 
-        {
-            if (output_ext == "tiff" && quality != 80) spdlog::warn("Quality is ignored for tiff files");
 
-            // check if input directory exists
-            if (!utils::is_directory(input_path))
+        ResourceBudget overrides;
+        if (!limit_memory.empty()) overrides.memory = resources::parse_size(limit_memory);
+        if (!limit_map.empty()) overrides.map = resources::parse_size(limit_map);
+        if (!limit_disk.empty()) overrides.disk = resources::parse_size(limit_disk);
+        if (!limit_area.empty()) overrides.area = resources::parse_size(limit_area);
+        const bool streaming = input_path == "-" || output_path == "-";
+        const bool single_file = serve_socket.empty() && http_address.empty() && jobs_path.empty() && inventory_path.empty() && atlas_path.empty() && tiles_path.empty() &&
+            (streaming || utils::is_file(input_path));
+
+        PixelPoolOptions pixel_pool_options;
+        pixel_pool_options.max_idle_bytes = resources::parse_size(pixel_pool_idle);
+        pixel_pool_options.huge_pages = huge_pages;
+
+        // Worker processes are started before anything initializes ImageMagick in this process.
+        unique_ptr<ProcessPool> worker_processes;
+        unique_ptr<ConvertEngine> engine;
+        if (processes != 0 && serve_socket.empty() && http_address.empty() && inventory_path.empty() && atlas_path.empty() && tiles_path.empty() && !single_file) {
+            ProcessPoolOptions pool_options;
+            pool_options.executable = process_pool::current_executable(argv[0]);
+            pool_options.limits = overrides;
+            pool_options.log_level = log_level_option->count() != 0 ? log_options.level : verbose ? "debug" : "warn";
+            pool_options.recycle_after = recycle_after;
+            pool_options.recycle_rss_growth = resources::parse_size(recycle_rss);
+            pool_options.pixel_pool = use_pixel_pool;
+            pool_options.pixel_pool_options = pixel_pool_options;
+            pool_options.target_profile = target_profile.empty() ? "" : filesystem::absolute(target_profile).string();
+            pool_options.rendering_intent = rendering_intent;
+            worker_processes = make_unique<ProcessPool>(processes, pool_options);
+            spdlog::info("Converting in {} worker processes", processes);
+        }
+        else {
+            // The allocator has to be in place before ImageMagick allocates anything.
+            if (use_pixel_pool && !pixel_pool::install(pixel_pool_options)) spdlog::warn("ImageMagick is already initialized, --pixel-pool is ignored");
+            engine = make_unique<ConvertEngine>(single_file ? 1 : num_threads, overrides, numa);
+        }
+        if (!trace_path.empty()) trace::start();
+
+        if (!serve_socket.empty()) {
+            JobServer(serve_socket, engine->pool(), run_job).run();
+            return 0;
+        }
+        if (!http_address.empty()) {
+            serve_http(*engine, http_address, input_path, resources::parse_size(cache_size), quality, comp_mode);
+            return 0;
+        }
+
+        ShardSpec shard_spec;
+        if (!shard_text.empty()) shard_spec = shard::parse(shard_text);
+        shard_spec.balance_by_size = shard_by == "size";
+        unique_ptr<Journal> journal;
+        if (!journal_path.empty()) journal = make_unique<Journal>(journal_path, resume);
+        unique_ptr<CostTable> costs;
+        if (!costs_path.empty()) costs = make_unique<CostTable>(costs_path);
+        dedupe.threads = num_threads;
+
+        // Manifest and directory batches, on the engine's threads or in worker processes.
+        const auto run_batch = [&](auto& runner) {
+            // Batch runs stop starting jobs on SIGINT/SIGTERM and let the running ones finish.
+            const InterruptScope interrupt_scope(runner);
+
+            if (!jobs_path.empty())
             {
-            	spdlog::error("Directory {} does not exist", utils::quote(input_path));
-				return 1;
+                // With a manifest, the optional positional argument is the default output directory.
+                const string output_dir = !output_path.empty() ? output_path : input_path;
+                if (!output_dir.empty()) filesystem::create_directories(output_dir);
+                start = std::chrono::high_resolution_clock::now();
+                const size_t failed = convert_manifest(runner, jobs_path, jobs_result.empty() ? jobs_path + ".results.jsonl" : jobs_result,
+                    output_dir, output_ext, compression_mode, quality, scale, overwrite, !verbose, journal.get(), shard_spec, costs.get());
+                end = std::chrono::high_resolution_clock::now();
+                if (failed != 0) spdlog::warn("{} job(s) failed", failed);
+                return;
             }
 
+            if (output_ext == "tiff" && quality != 80) spdlog::warn("Quality is ignored for tiff files");
+
+            // check if input directory exists
+            if (!utils::is_directory(input_path)) throw runtime_error("Directory " + utils::quote(input_path) + " does not exist");
+
             // check if output directory exists
             if (!utils::is_directory(output_path))
             {
@@ -237,15 +714,141 @@ int main(int argc, char** argv)
                 filesystem::create_directory(output_path);
             }
             start = std::chrono::high_resolution_clock::now();
-            convert_images(input_path, output_path, input_ext, output_ext, comp_mode, quality, scale, overwrite, num_threads);
+            convert_images(runner, input_path, output_path, input_ext, output_ext, comp_mode, quality, scale, overwrite, !verbose,
+                journal.get(), shard_spec, costs.get(), dedupe);
             end = std::chrono::high_resolution_clock::now();
+        };
+
+        if (!inventory_path.empty())
+        {
+            vector<string> files;
+            {
+                ScopedStage stage(Stage::Enumerate);
+                files = utils::is_file(input_path) ? vector<string>{ input_path } : utils::get_files(input_path, input_ext);
+            }
+            keep_shard(files, input_path, shard_spec, [](const string& path) { return path; });
+            start = std::chrono::high_resolution_clock::now();
+            const size_t failed = inventory::run(engine->pool(), files, inventory_path, !verbose);
+            end = std::chrono::high_resolution_clock::now();
+            if (failed != 0) spdlog::warn("{} file(s) could not be read", failed);
+        }
+        else if (!atlas_path.empty())
+        {
+            vector<string> files;
+            {
+                ScopedStage stage(Stage::Enumerate);
+                files = utils::get_files(input_path, input_ext);
+            }
+            keep_shard(files, input_path, shard_spec, [](const string& path) { return path; });
+            if (files.empty()) throw runtime_error("No files found in input directory: " + utils::quote(input_path));
+            start = std::chrono::high_resolution_clock::now();
+            const size_t failed = atlas::build(engine->pool(), input_path, files, atlas_path, atlas_options, !verbose);
+            end = std::chrono::high_resolution_clock::now();
+            if (failed != 0) spdlog::warn("{} file(s) could not be read and are not in the atlas", failed);
+        }
+        else if (!tiles_path.empty())
+        {
+            if (!utils::is_file(input_path)) throw runtime_error("File " + utils::quote(input_path) + " does not exist");
+            tile_options.format = output_ext;
+            tile_options.quality = quality;
+            tile_options.skip_uniform = !keep_uniform_tiles;
+            start = std::chrono::high_resolution_clock::now();
+            tiles::build(engine->pool(), input_path, tiles_path, tile_options, !verbose);
+            end = std::chrono::high_resolution_clock::now();
+        }
+        else if (streaming && jobs_path.empty())
+        {
+#ifdef _WIN32
+            _setmode(_fileno(stdin), _O_BINARY);
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            start = std::chrono::high_resolution_clock::now();
+            string format = !out_format.empty() ? out_format : output_ext;
+            if (format.empty() && output_path != "-") format = utils::get_extension(output_path);
+            if (!format.empty() && format[0] == '.') format.erase(0, 1);
+
+            string input;
+            ConvertJob job;
+            if (input_path == "-") {
+                input = read_stream(stdin);
+                job.input_data = input.data();
+                job.input_size = input.size();
+            }
+            else {
+                job.input_path = input_path;
+            }
+            if (output_path != "-") job.output_path = output_path;
+            job.format = format;
+            job.quality = quality;
+            job.compression = comp_mode;
+            job.scale = scale;
+            job.overwrite = overwrite;
+
+            const ConvertResult result = ConvertEngine::convert(job);
+            if (!result.ok) throw runtime_error(result.error);
+            if (output_path == "-") write_stream(stdout, result.output);
+            end = std::chrono::high_resolution_clock::now();
+        }
+        else if (single_file) 
+        {
+            start = std::chrono::high_resolution_clock::now();
+            if (utils::get_extension(output_path) == "tiff" && quality != 95) spdlog::warn("Quality is ignored for tiff files");
+            ConvertJob job;
+            job.input_path = input_path;
+            job.output_path = output_path;
+            job.quality = quality;
+            job.compression = comp_mode;
+            job.scale = scale;
+            job.overwrite = overwrite;
+            const ConvertResult result = ConvertEngine::convert(job);
+            if (!result.ok) throw runtime_error(result.error);
+            end = std::chrono::high_resolution_clock::now();
+        }
+        else if (worker_processes)
+        {
+            run_batch(*worker_processes);
+        }
+        else
+        {
+            run_batch(*engine);
         }
 	    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
         // convert duration to seconds and print
         const double seconds = duration.count() / 1e6;
 
+        if (journal) journal->flush();
         spdlog::info("Took {} seconds", seconds);
+        if (print_stats || !stats_json.empty()) report_stage_stats(print_stats, stats_json);
+        if (!trace_path.empty()) {
+            trace::write(trace_path);
+            spdlog::info("Wrote trace to {}", utils::quote(trace_path));
+        }
 
+        const SpillStats spills = resources::spill_stats();
+        if (spills.map_images || spills.disk_images) {
+            spdlog::warn("Pixel cache spilled for {} image(s): {} memory-mapped, {} on disk. Consider raising --limit-memory/--limit-area",
+                spills.map_images + spills.disk_images, spills.map_images, spills.disk_images);
+        }
+
+        if (pixel_pool::installed()) {
+            const PixelPoolStats pool = pixel_pool::stats();
+            const uint64_t reused = pool.thread_hits + pool.shared_hits;
+            spdlog::info("Pixel pool: {} large allocations, {:.1f}% reused ({} from the same thread), peak {} mapped, {} idle",
+                pool.allocations, pool.allocations ? 100.0 * reused / pool.allocations : 0.0, pool.thread_hits,
+                resources::format_size(pool.peak_mapped_bytes), resources::format_size(pool.idle_bytes));
+        }
+
+        if (color::has_target_profile()) {
+            const ColorProfileStats color_stats = color::stats();
+            spdlog::info("Color management: {} images through {} cached transforms, {} converted uncached",
+                color_stats.images, color_stats.transforms, color_stats.uncached);
+        }
+
+        if (worker_processes && worker_processes->failed()) {
+            spdlog::error("Worker processes failed to start; the remaining jobs were not converted");
+            return 1;
+        }
+        if (interrupted) return 130;
         spdlog::info("Done");
         return 0;
     }
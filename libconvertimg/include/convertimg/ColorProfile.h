@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <Magick++.h>
+
+struct ColorProfileStats {
+    uint64_t images = 0;      // converted through a cached transform
+    uint64_t transforms = 0;  // transforms built, one per distinct source profile
+    uint64_t uncached = 0;    // converted by ImageMagick directly (colorspaces the cache does not cover)
+};
+
+// ICC conversion of every decoded image to one target profile. A transform is built once per
+// source profile (sampling ImageMagick's own profile conversion on a grid of colours) and shared
+// read-only by all threads; each image then only costs a lookup and interpolation through it.
+namespace color {
+    // Converts images to the ICC profile in `icc_path` from now on. `intent` is perceptual,
+    // relative, saturation or absolute. Throws std::runtime_error when the file is not an ICC profile.
+    // Does not initialize ImageMagick.
+    void set_target_profile(const std::string& icc_path, const std::string& intent = "perceptual");
+    bool has_target_profile();
+
+    // Converts `image` from its embedded profile to the target and embeds the target. Images without
+    // a profile are left as they are, as their colours have no defined meaning to convert from.
+    void to_target(Magick::Image& image);
+
+    ColorProfileStats stats();
+}  // namespace color
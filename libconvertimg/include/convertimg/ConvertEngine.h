@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <Magick++.h>
+
+#include "convertimg/Converter.h"
+#include "convertimg/ResourceBudget.h"
+
+class ThreadPool;
+
+// One conversion. The input is either a file (`input_path`) or an in-memory buffer
+// (`input_data`/`input_size`, which must stay valid until the job completes). An empty
+// `output_path` returns the encoded image in `ConvertResult::output` instead of writing a file.
+struct ConvertJob {
+    std::string input_path;
+    const void* input_data = nullptr;
+    size_t input_size = 0;
+
+    std::string output_path;
+    std::string format;  // empty: derived from the output extension (file) or kept from the input (buffer)
+    int quality = 80;
+    CompressionMode compression = CompressionMode::None;
+    double scale = 1.0;
+    size_t max_width = 0;  // 0: no limit
+    bool overwrite = false;
+};
+
+struct ConvertResult {
+    bool ok = false;
+    std::string error;
+    std::string output_path;  // path actually written, for file outputs
+    Magick::Blob output;      // encoded image, for in-memory outputs
+    double milliseconds = 0;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;
+    bool cancelled = false;   // never started because the engine was cancelled
+};
+
+// Conversion engine owning the worker pool. Initializes ImageMagick on first construction and
+// applies a pixel cache budget sized for its thread count. Jobs may be submitted from any thread.
+// With `numa`, the pool's threads are placed per NUMA node (see ThreadPool).
+class ConvertEngine {
+public:
+    using Callback = std::function<void(const ConvertJob& job, ConvertResult& result)>;
+
+    explicit ConvertEngine(unsigned int threads = 0, const ResourceBudget& limits = {}, bool numa = false);
+    ~ConvertEngine();  // waits for outstanding jobs
+
+    // Runs `job` on the pool and invokes `on_complete` on the worker thread that ran it.
+    void submit(ConvertJob job, Callback on_complete);
+    std::future<ConvertResult> submit(ConvertJob job);
+
+    // Runs `job` on the calling thread. Never throws; failures are reported in the result.
+    static ConvertResult convert(const ConvertJob& job);
+
+    // Blocks until every job submitted so far has completed.
+    void wait();
+
+    // Jobs that have not started yet complete right away with `cancelled` set; running jobs finish
+    // normally. Only sets an atomic flag, so it is safe to call from a signal handler.
+    void cancel();
+    bool cancelled() const;
+
+    unsigned int thread_count() const;
+    ThreadPool& pool();
+
+    ConvertEngine(const ConvertEngine&) = delete;
+    ConvertEngine& operator=(const ConvertEngine&) = delete;
+
+private:
+    unsigned int threads_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::mutex pending_mutex_;
+    std::condition_variable idle_;
+    size_t pending_;
+    std::atomic<bool> cancelled_;
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <Magick++.h>
+
+enum class CompressionMode {
+    Lossy,
+    Lossless,
+    None
+};
+
+CompressionMode get_compression_mode(const std::string& mode);
+void set_compression(Magick::Image& image, const std::string& output_ext, CompressionMode mode);
+
+// First of `base_path`, `base_name_1.ext`, `base_name_2.ext`, ... that does not exist yet.
+std::string get_new_path(const std::string& base_path);
+std::string make_output_path(const std::string& input_path, const std::string& output_dir, const std::string& output_ext);
+
+// Whole-file I/O for the staged conversion paths. Both throw std::runtime_error on failure.
+// `write_blob` replaces `path` atomically, so an interrupted write never leaves a truncated image.
+Magick::Blob read_blob(const std::string& path);
+void write_blob(const Magick::Blob& blob, const std::string& path);
+
+// Scale, quality and compression shared by every conversion path.
+void transform_image(
+    Magick::Image& image, int quality, CompressionMode compression,
+    double scale, const std::string& output_ext);
+
+// In-memory variant of `convert_image`. The input format is detected by ImageMagick from the blob's
+// magic bytes; an empty `output_format` keeps it. A non-zero `max_width` further limits the scale so
+// the output is never wider than it.
+Magick::Blob convert_blob(
+    const Magick::Blob& input, const std::string& output_format,
+    int quality, CompressionMode compression,
+    double scale, size_t max_width = 0);
+
+// Same, decoding the `size` bytes at `data` in place; the caller keeps them alive for the call.
+Magick::Blob convert_blob(
+    const void* data, size_t size, const std::string& output_format,
+    int quality, CompressionMode compression,
+    double scale, size_t max_width = 0);
+
+// Returns the path actually written, which differs from `output_path` when not overwriting.
+// A non-empty `format` forces the encoder instead of deriving it from the output extension.
+// Animations and multi-page files keep every frame when the output format can hold them (otherwise
+// the first); called on a ThreadPool worker, the frames are transformed in parallel on that pool.
+std::string convert_image(
+    const std::string& input_path, const std::string& output_path,
+    int quality, CompressionMode compression,
+    double scale, bool overwrite, const std::string& format = "");
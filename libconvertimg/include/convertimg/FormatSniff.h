@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Image format detection from a file's leading bytes, so inputs are classified by what they
+// contain rather than by their (possibly missing, misleading or upper-case) extension.
+namespace sniff {
+    constexpr size_t header_bytes = 64;  // every signature in the table, and an ISO-BMFF ftyp box's brands
+
+    // Canonical format name ("jpeg", "png", "tiff", ...) of the signature `header` starts with;
+    // empty when none matches.
+    std::string detect(const unsigned char* header, size_t size);
+
+    // Reads the first `header_bytes` of `path` and detects its format; empty when the file cannot
+    // be read or matches no signature. Camera raws that are plain TIFF containers (dng, nef, arw, ...)
+    // have no signature of their own, so a TIFF named with one of their extensions is reported as that raw.
+    std::string detect_file(const std::string& path);
+
+    // Canonical format name for a format or extension, any case, with or without the dot:
+    // "JPG", ".jpe" and "jpeg" all give "jpeg"; "tif" gives "tiff". Raw formats keep their own names.
+    // Unknown names are lower-cased.
+    std::string canonical_format(const std::string& name);
+
+    // Formats without a reliable signature (e.g. tga, svg) that are recognized by extension instead.
+    bool is_headerless_format(const std::string& canonical);
+}  // namespace sniff
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+struct NumaNode {
+    unsigned int id = 0;
+    std::vector<unsigned int> cpus;  // logical CPU numbers (group * 64 + index on Windows)
+};
+
+namespace numa {
+    // NUMA nodes that have CPUs this process may run on. A single node holding every allowed CPU
+    // where the topology is not available.
+    std::vector<NumaNode> topology();
+
+    // Restricts the calling thread to `cpus`. Returns false where that is not supported.
+    bool pin_current_thread(const std::vector<unsigned int>& cpus);
+
+    // Makes the calling thread's new pages come from the node it runs on, overriding an inherited
+    // interleave policy (e.g. `numactl --interleave`). A no-op where that is already the default.
+    void prefer_local_memory();
+}  // namespace numa
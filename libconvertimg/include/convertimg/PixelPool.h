@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct PixelPoolOptions {
+    size_t min_block = 256 << 10;       // smaller allocations go straight to the heap
+    uint64_t max_idle_bytes = 1ull << 30;  // freed blocks kept for reuse, across all threads
+    bool huge_pages = false;            // ask for transparent huge pages on blocks of 2 MiB and up
+};
+
+struct PixelPoolStats {
+    uint64_t allocations = 0;        // pooled (large) allocations
+    uint64_t thread_hits = 0;        // served from the calling thread's own freed blocks
+    uint64_t shared_hits = 0;        // served from blocks other threads gave back
+    uint64_t fresh_mappings = 0;     // needed a new mapping
+    uint64_t mapped_bytes = 0;       // currently mapped, in use or idle
+    uint64_t peak_mapped_bytes = 0;
+    uint64_t idle_bytes = 0;         // mapped but free for reuse
+};
+
+// Size-class allocator for ImageMagick, installed through SetMagickMemoryMethods and
+// SetMagickAlignedMemoryMethods. Large blocks (pixel caches, row buffers) are mapped directly,
+// rounded up to one of four sizes per power of two, and recycled through a small per-thread cache
+// with a shared overflow, so batches of similar images stop paying for mmap/munmap and page faults
+// on every file. Small allocations pass through to the heap.
+namespace pixel_pool {
+    // Must run before ImageMagick is initialized, as blocks of the previous allocator cannot be
+    // freed by this one. Returns false and changes nothing when ImageMagick is already running.
+    bool install(const PixelPoolOptions& options = {});
+    bool installed();
+
+    PixelPoolStats stats();
+}  // namespace pixel_pool
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Magick { class Image; }
+
+// Pixel cache limits handed to ImageMagick. A value of 0 means "leave ImageMagick's default".
+struct ResourceBudget {
+    uint64_t memory = 0;
+    uint64_t map = 0;
+    uint64_t disk = 0;
+    uint64_t area = 0;
+};
+
+struct SpillStats {
+    uint64_t map_images = 0;   // pixel cache backed by a memory-mapped file
+    uint64_t disk_images = 0;  // pixel cache backed by plain disk I/O
+};
+
+namespace resources {
+    // Parses sizes like "512MiB", "2GB", "4096" (bytes). Throws std::invalid_argument on bad input.
+    uint64_t parse_size(const std::string& text);
+    std::string format_size(uint64_t bytes);
+
+    // Memory available to this process: cgroup v2 `memory.max` when set, physical RAM otherwise.
+    uint64_t detect_memory_limit();
+
+    // Splits the detected memory between `workers` concurrent jobs. Explicit (non-zero) fields
+    // in `overrides` win over the derived defaults.
+    ResourceBudget derive_budget(unsigned int workers, const ResourceBudget& overrides);
+
+    void apply(const ResourceBudget& budget);
+
+    // Records whether the image's pixel cache spilled out of heap memory.
+    void note_pixel_cache(const Magick::Image& image, const std::string& path);
+    SpillStats spill_stats();
+}  // namespace resources
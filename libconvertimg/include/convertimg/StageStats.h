@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The steps of a conversion, in pipeline order.
+enum class Stage {
+    Enumerate,
+    Read,
+    Decode,
+    Color,   // conversion to the target ICC profile (--target-profile)
+    Resize,
+    Encode,
+    Write,
+    Count
+};
+
+const char* stage_name(Stage stage);
+
+// Log-linear (HDR style) histogram of microsecond values: 16 sub-buckets per power of two keep every
+// recorded value within ~3% of its bucket midpoint, from 1 us up to ~70 minutes. Reported values
+// (percentiles, max, mean) are bucket midpoints.
+class Histogram {
+public:
+    static constexpr size_t bucket_count = 464;
+
+    static size_t bucket_of(uint64_t value);
+    static uint64_t value_of(size_t bucket);
+
+    void record(uint64_t value);
+    void add(size_t bucket, uint64_t count);
+    void merge(const Histogram& other);
+
+    // `fraction` in [0, 1], e.g. 0.99 for p99. Returns 0 when nothing was recorded.
+    uint64_t percentile(double fraction) const;
+    uint64_t count() const;
+    uint64_t max() const;
+    double mean() const;
+
+private:
+    std::array<uint64_t, bucket_count> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+struct StageSummary {
+    std::string format;  // lower case, without the dot; empty for stages not tied to a format
+    Stage stage = Stage::Read;
+    Histogram histogram;
+};
+
+namespace stats {
+    // Adds one sample to the calling thread's histograms. Each thread owns its histograms, so
+    // recording never takes a lock; `snapshot` merges them.
+    void record(Stage stage, std::string_view format, std::chrono::steady_clock::duration elapsed);
+
+    // Per (format, stage) histograms merged across every thread that recorded so far, sorted by
+    // format then stage. Safe to call while workers are still recording.
+    std::vector<StageSummary> snapshot();
+}  // namespace stats
+
+// Times its own lifetime and records it under `stage` when destroyed, and as a trace event while
+// tracing is enabled.
+class ScopedStage {
+public:
+    ScopedStage(Stage stage, std::string_view format = {});
+    ~ScopedStage();
+
+    ScopedStage(const ScopedStage&) = delete;
+    ScopedStage& operator=(const ScopedStage&) = delete;
+
+    // For stages whose format is only known once they ran, e.g. decoding a blob.
+    void set_format(std::string_view format);
+
+private:
+    Stage stage_;
+    std::string format_;
+    std::chrono::steady_clock::time_point start_;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <condition_variable>
+
+class ThreadPool {
+private:
+    // Workers of one NUMA node and their queue. Without NUMA placement there is a single node.
+    struct Node {
+        std::vector<unsigned int> cpus;
+        std::deque<std::function<void()>> tasks;
+        std::condition_variable condition;
+        size_t idle = 0;     // workers waiting on `condition`
+        size_t wakeups = 0;  // notified but not yet awake
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Node>> nodes;
+    std::vector<size_t> worker_nodes;  // node of each worker; round-robin order for outside submissions
+    size_t next_worker;
+
+    std::mutex queue_mutex;
+    bool stop;
+
+    size_t target_node();  // under queue_mutex
+    void notify(size_t node);  // under queue_mutex
+    void work(size_t node, bool pinned);
+
+public:
+    // With `numa`, workers are spread over the NUMA nodes in proportion to their CPUs, pinned to
+    // their node and allocate from its memory. Each node has its own queue: tasks submitted by a
+    // worker stay on its node, others are dealt out round-robin, and a worker only takes tasks
+    // from another node once its own queue is empty.
+    explicit ThreadPool(size_t threads, bool numa = false);
+    ~ThreadPool();
+
+    template<class F>
+    void enqueue(F&& f) {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        if (stop) throw std::runtime_error("enqueue on stopped ThreadPool");
+        const size_t node = target_node();
+        nodes[node]->tasks.emplace_back(std::forward<F>(f));
+        notify(node);
+    }
+
+    // Runs `task(i)` for every i in [0, count). The caller works through the indices itself while
+    // idle workers join in, so it never waits on a queued task and may be a worker of this pool.
+    // Rethrows the first exception once every index has run.
+    void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+    size_t node_count() const;
+
+    // The pool the calling thread works for, or null outside any pool.
+    static ThreadPool* current();
+
+    // Delete copy and move constructors and assignment operators
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Timeline of what every thread was doing, exported in Chrome trace-event format for
+// chrome://tracing or https://ui.perfetto.dev. Each thread records into its own fixed-size ring, so
+// tracing never locks on the hot path; when a ring is full its oldest events are overwritten.
+namespace trace {
+    // Clears previous events and starts recording. Until then `record` is a single relaxed load.
+    void start(size_t events_per_thread = 1 << 16);
+    void stop();
+    bool enabled();
+
+    // `name` must outlive the trace (a string literal or `stage_name`). `detail` is truncated to
+    // a few dozen characters and shown as the event's argument.
+    void record(const char* name, std::string_view detail,
+        std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end);
+
+    // Writes every recorded event as a JSON trace. Call it once the traced work has finished.
+    void write(const std::string& path);
+
+    // Records its own lifetime as one event. `detail` must stay valid until the span ends.
+    class Span {
+    public:
+        explicit Span(const char* name, std::string_view detail = {});
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* name_;
+        std::string_view detail_;
+        std::chrono::steady_clock::time_point begin_;
+    };
+}  // namespace trace
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace utils {
+    std::string quote(const std::string& str);
+    bool is_file(const std::string& path);
+    bool is_directory(const std::string& path);
+    std::string get_extension(const std::string& path);
+    std::vector<std::string> split(const std::string& str, char delimiter);
+
+    // Image files directly inside `path`, classified by their leading bytes (see sniff::detect), so
+    // upper-case, unusual or missing extensions do not matter and other files are skipped. A non-empty
+    // `ext` ("jpg", ".JPEG", "tif", ...) keeps only files of that detected format.
+    std::vector<std::string> get_files(const std::string& path, const std::string& ext);
+}  // namespace utils
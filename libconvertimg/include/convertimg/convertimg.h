@@ -0,0 +1,91 @@
+/*
+ * Stable C ABI of libconvertimg.
+ *
+ * Structs passed in carry their own size (`struct_size`) so fields can be appended in later
+ * versions without breaking callers compiled against an older header. Always initialize jobs with
+ * cimg_job_init(). Define CONVERTIMG_SHARED when building or consuming libconvertimg as a DLL.
+ */
+#pragma once
+
+#include <stddef.h>
+
+#if defined(CONVERTIMG_SHARED) && defined(_WIN32)
+#  ifdef CONVERTIMG_BUILD
+#    define CONVERTIMG_API __declspec(dllexport)
+#  else
+#    define CONVERTIMG_API __declspec(dllimport)
+#  endif
+#elif defined(CONVERTIMG_SHARED)
+#  define CONVERTIMG_API __attribute__((visibility("default")))
+#else
+#  define CONVERTIMG_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CIMG_ABI_VERSION 1
+
+typedef struct cimg_engine cimg_engine;
+
+typedef enum cimg_compression {
+    CIMG_COMPRESSION_NONE = 0,
+    CIMG_COMPRESSION_LOSSY = 1,
+    CIMG_COMPRESSION_LOSSLESS = 2
+} cimg_compression;
+
+typedef struct cimg_job {
+    size_t struct_size;
+
+    /* Input: a file path, or a buffer that must stay valid until the job completes. */
+    const char* input_path;
+    const void* input_data;
+    size_t input_size;
+
+    /* Output: a file path, or NULL to receive the encoded image in the result. */
+    const char* output_path;
+    const char* format; /* NULL: from output extension, or same as input for buffers */
+
+    int quality;        /* 1-100 */
+    int compression;    /* cimg_compression */
+    double scale;
+    size_t max_width;   /* 0: no limit */
+    int overwrite;
+} cimg_job;
+
+/* Only valid for the duration of the callback; copy what you need to keep. */
+typedef struct cimg_result {
+    size_t struct_size;
+    int ok;
+    const char* error;        /* NULL on success */
+    const char* output_path;  /* path written, or NULL for buffer outputs */
+    const void* output_data;  /* encoded image for buffer outputs, NULL otherwise */
+    size_t output_size;
+    double milliseconds;
+} cimg_result;
+
+typedef void (*cimg_callback)(void* user_data, const cimg_result* result);
+
+CONVERTIMG_API int cimg_abi_version(void);
+
+CONVERTIMG_API void cimg_job_init(cimg_job* job);
+
+/* threads == 0 uses one thread per CPU core. Returns NULL on failure. */
+CONVERTIMG_API cimg_engine* cimg_engine_create(unsigned int threads);
+
+/* Waits for outstanding jobs, then frees the engine. */
+CONVERTIMG_API void cimg_engine_destroy(cimg_engine* engine);
+
+/* Queues the job; `callback` runs on a worker thread when it completes. Returns 0 on success. */
+CONVERTIMG_API int cimg_submit(cimg_engine* engine, const cimg_job* job, cimg_callback callback, void* user_data);
+
+/* Runs the job on the calling thread and invokes `callback` before returning. Returns result->ok. */
+CONVERTIMG_API int cimg_convert(cimg_engine* engine, const cimg_job* job, cimg_callback callback, void* user_data);
+
+/* Blocks until every job submitted so far has completed. */
+CONVERTIMG_API void cimg_engine_wait(cimg_engine* engine);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,289 @@
+#include "convertimg/ColorProfile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "convertimg/Utils.h"
+
+using namespace std;
+
+namespace {
+    // A sampled transform: `grid` points per input channel (channel 0 varies fastest), each holding
+    // `outputs` values in 0..65535.
+    struct Lut {
+        size_t inputs = 0;
+        size_t grid = 0;
+        size_t outputs = 0;
+        string output_map;
+        MagickCore::ColorspaceType output_colorspace = MagickCore::sRGBColorspace;
+        vector<float> table;
+    };
+
+    struct Target {
+        string profile;
+        Magick::RenderingIntent intent = Magick::PerceptualIntent;
+    };
+
+    // Transforms are bucketed by a hash of the source profile, and matched on its full bytes.
+    struct CacheEntry {
+        string profile;
+        size_t inputs;
+        uint64_t serial;
+        shared_future<shared_ptr<const Lut>> lut;
+    };
+
+    mutex cache_mutex;
+    shared_ptr<const Target> target;
+    unordered_map<size_t, vector<CacheEntry>> cache;
+    uint64_t next_serial = 0;
+    atomic<uint64_t> converted{ 0 }, built{ 0 }, uncached{ 0 };
+
+    // Samples per input channel: every 8-bit level for gray; 33 (RGB) and 17 (CMYK) keep the
+    // interpolation error well below one 8-bit step while building in a few milliseconds.
+    size_t grid_size(const size_t inputs) {
+        return inputs == 1 ? 256 : inputs == 3 ? 33 : 17;
+    }
+
+    // Export map of the colour channels of `colorspace`; empty for those the cache does not cover.
+    string channel_map(const MagickCore::ColorspaceType colorspace) {
+        switch (colorspace) {
+        case MagickCore::sRGBColorspace:
+        case MagickCore::RGBColorspace:
+            return "RGB";
+        case MagickCore::CMYKColorspace:
+            return "CMYK";
+        case MagickCore::GRAYColorspace:
+            return "I";
+        default:
+            return "";
+        }
+    }
+
+    // MagickCore exception info for direct MagickCore calls, rethrown the way Magick++ does.
+    struct ExceptionScope {
+        MagickCore::ExceptionInfo* info = MagickCore::AcquireExceptionInfo();
+
+        ~ExceptionScope() { MagickCore::DestroyExceptionInfo(info); }
+        void check(const bool quiet) const { Magick::throwException(info, quiet); }
+    };
+
+    // Tags `image` with `profile` without converting its pixels.
+    void attach_profile(Magick::Image& image, const string& profile) {
+        image.modifyImage();
+        MagickCore::StringInfo* info = MagickCore::BlobToStringInfo(profile.data(), profile.size());
+        const ExceptionScope exception;
+        MagickCore::SetImageProfile(image.image(), "icc", info, exception.info);
+        MagickCore::DestroyStringInfo(info);
+        exception.check(image.quiet());
+    }
+
+    shared_ptr<const Lut> build_lut(const string_view& source, const string& input_map, const Target& to) {
+        auto lut = make_shared<Lut>();
+        lut->inputs = input_map.size();
+        lut->grid = grid_size(lut->inputs);
+        size_t points = 1;
+        for (size_t c = 0; c < lut->inputs; c++) points *= lut->grid;
+
+        vector<uint16_t> samples(points * lut->inputs);
+        for (size_t p = 0; p < points; p++) {
+            size_t index = p;
+            for (size_t c = 0; c < lut->inputs; c++) {
+                samples[p * lut->inputs + c] = static_cast<uint16_t>((index % lut->grid) * 65535 / (lut->grid - 1));
+                index /= lut->grid;
+            }
+        }
+
+        Magick::Image grid(points, 1, input_map, Magick::ShortPixel, samples.data());
+        attach_profile(grid, string(source));
+        grid.renderingIntent(to.intent);
+        grid.profile("icc", Magick::Blob(to.profile.data(), to.profile.size()));
+
+        lut->output_colorspace = grid.colorSpace();
+        lut->output_map = channel_map(lut->output_colorspace);
+        if (lut->output_map.empty()) throw runtime_error("Unsupported colorspace of the target profile");
+        lut->outputs = lut->output_map.size();
+        vector<uint16_t> result(points * lut->outputs);
+        grid.write(0, 0, points, 1, lut->output_map, Magick::ShortPixel, result.data());
+        lut->table.assign(result.begin(), result.end());
+        return lut;
+    }
+
+    shared_ptr<const Lut> lookup(const string_view& source, const string& input_map, const Target& to) {
+        const size_t key = hash<string_view>()(source);
+        promise<shared_ptr<const Lut>> building;
+        shared_future<shared_ptr<const Lut>> entry;
+        uint64_t serial = 0;
+        bool found = false;
+        {
+            lock_guard<mutex> lock(cache_mutex);
+            vector<CacheEntry>& bucket = cache[key];
+            for (const CacheEntry& cached : bucket) {
+                if (cached.inputs == input_map.size() && cached.profile == source) {
+                    entry = cached.lut;
+                    break;
+                }
+            }
+            if (entry.valid()) {
+                found = true;
+            }
+            else {
+                entry = building.get_future().share();
+                serial = next_serial++;
+                bucket.push_back({ string(source), input_map.size(), serial, entry });
+            }
+        }
+        // Waited on and built outside the lock, so other profiles never wait for this build.
+        if (found) return entry.get();
+        try {
+            building.set_value(build_lut(source, input_map, to));
+            built++;
+        }
+        catch (...) {
+            building.set_exception(current_exception());
+            // Not cached: the next image with this profile tries again.
+            lock_guard<mutex> lock(cache_mutex);
+            const auto it = cache.find(key);
+            if (it != cache.end()) {
+                auto& bucket = it->second;
+                bucket.erase(remove_if(bucket.begin(), bucket.end(), [&](const CacheEntry& cached) { return cached.serial == serial; }), bucket.end());
+                if (bucket.empty()) cache.erase(it);
+            }
+        }
+        return entry.get();
+    }
+
+    // Multilinear interpolation of `lut` at `in` (0..65535 per input channel) into `out`.
+    void interpolate(const Lut& lut, const uint16_t* in, float* out) {
+        size_t base = 0, stride = 1;
+        float fraction[4];
+        size_t strides[4];
+        for (size_t c = 0; c < lut.inputs; c++) {
+            const float position = in[c] * (lut.grid - 1) / 65535.0f;
+            const size_t cell = min(static_cast<size_t>(position), lut.grid - 2);
+            fraction[c] = position - cell;
+            strides[c] = stride;
+            base += cell * stride;
+            stride *= lut.grid;
+        }
+        for (size_t k = 0; k < lut.outputs; k++) out[k] = 0;
+        for (size_t corner = 0; corner < (size_t(1) << lut.inputs); corner++) {
+            float weight = 1;
+            size_t offset = base;
+            for (size_t c = 0; c < lut.inputs; c++) {
+                if (corner & (size_t(1) << c)) {
+                    weight *= fraction[c];
+                    offset += strides[c];
+                }
+                else {
+                    weight *= 1 - fraction[c];
+                }
+            }
+            if (weight == 0) continue;
+            const float* value = &lut.table[offset * lut.outputs];
+            for (size_t k = 0; k < lut.outputs; k++) out[k] += weight * value[k];
+        }
+    }
+
+    void apply(const Lut& lut, Magick::Image& image, const string& input_map) {
+        const size_t alpha = image.alpha() ? 1 : 0;
+        const size_t in_stride = lut.inputs + alpha, out_stride = lut.outputs + alpha;
+        const size_t pixels = image.columns() * image.rows();
+
+        // One buffer, converted in place: front to back when pixels shrink (CMYK to RGB), back to
+        // front when they grow, so no pixel is overwritten before it is read.
+        vector<uint16_t> buffer(pixels * max(in_stride, out_stride));
+        image.write(0, 0, image.columns(), image.rows(), alpha ? input_map + "A" : input_map, Magick::ShortPixel, buffer.data());
+        const auto convert = [&](const size_t p) {
+            uint16_t source[5];
+            copy_n(&buffer[p * in_stride], in_stride, source);
+            float result[4];
+            interpolate(lut, source, result);
+            uint16_t* destination = &buffer[p * out_stride];
+            for (size_t k = 0; k < lut.outputs; k++) destination[k] = static_cast<uint16_t>(min(max(result[k], 0.0f), 65535.0f) + 0.5f);
+            if (alpha) destination[lut.outputs] = source[lut.inputs];
+        };
+        if (out_stride <= in_stride) {
+            for (size_t p = 0; p < pixels; p++) convert(p);
+        }
+        else {
+            for (size_t p = pixels; p-- > 0;) convert(p);
+        }
+
+        image.modifyImage();
+        const ExceptionScope exception;
+        MagickCore::SetImageColorspace(image.image(), lut.output_colorspace, exception.info);
+        MagickCore::ImportImagePixels(image.image(), 0, 0, image.columns(), image.rows(),
+            (alpha ? lut.output_map + "A" : lut.output_map).c_str(), MagickCore::ShortPixel, buffer.data(), exception.info);
+        exception.check(image.quiet());
+    }
+}
+
+void color::set_target_profile(const string& icc_path, const string& intent) {
+    ifstream file(icc_path, ios::binary);
+    if (!file) throw runtime_error("Failed to open " + utils::quote(icc_path));
+    auto next = make_shared<Target>();
+    next->profile.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    // Every ICC profile carries the "acsp" signature at byte 36 of its header.
+    if (next->profile.size() < 128 || next->profile.compare(36, 4, "acsp") != 0) {
+        throw runtime_error(utils::quote(icc_path) + " is not an ICC profile");
+    }
+
+    if (intent == "perceptual") next->intent = Magick::PerceptualIntent;
+    else if (intent == "relative") next->intent = Magick::RelativeIntent;
+    else if (intent == "saturation") next->intent = Magick::SaturationIntent;
+    else if (intent == "absolute") next->intent = Magick::AbsoluteIntent;
+    else throw runtime_error("Unknown rendering intent: " + utils::quote(intent));
+
+    lock_guard<mutex> lock(cache_mutex);
+    target = std::move(next);
+    cache.clear();
+}
+
+bool color::has_target_profile() {
+    lock_guard<mutex> lock(cache_mutex);
+    return target != nullptr;
+}
+
+void color::to_target(Magick::Image& image) {
+    shared_ptr<const Target> to;
+    {
+        lock_guard<mutex> lock(cache_mutex);
+        to = target;
+    }
+    if (to == nullptr) return;
+
+    const MagickCore::StringInfo* embedded = MagickCore::GetImageProfile(image.constImage(), "icc");
+    if (embedded == nullptr) return;
+    const string_view source(reinterpret_cast<const char*>(MagickCore::GetStringInfoDatum(embedded)),
+        MagickCore::GetStringInfoLength(embedded));
+    if (source == to->profile) return;
+
+    const string input_map = channel_map(image.colorSpace());
+    if (input_map.empty()) {
+        image.renderingIntent(to->intent);
+        image.profile("icc", Magick::Blob(to->profile.data(), to->profile.size()));
+        uncached++;
+        return;
+    }
+
+    const shared_ptr<const Lut> lut = lookup(source, input_map, *to);
+    apply(*lut, image, input_map);
+    attach_profile(image, to->profile);
+    converted++;
+}
+
+ColorProfileStats color::stats() {
+    ColorProfileStats stats;
+    stats.images = converted.load();
+    stats.transforms = built.load();
+    stats.uncached = uncached.load();
+    return stats;
+}
@@ -0,0 +1,137 @@
+#include "convertimg/ConvertEngine.h"
+
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#include "convertimg/StageStats.h"
+#include "convertimg/ThreadPool.h"
+#include "convertimg/Trace.h"
+#include "convertimg/Utils.h"
+
+using namespace std;
+
+namespace {
+    once_flag magick_initialized;
+}
+
+ConvertEngine::ConvertEngine(unsigned int threads, const ResourceBudget& limits, bool numa) : pending_(0), cancelled_(false) {
+    if (threads == 0) threads = max(thread::hardware_concurrency(), 1u);
+    threads_ = threads;
+
+    call_once(magick_initialized, [] { Magick::InitializeMagick(nullptr); });
+    resources::apply(resources::derive_budget(threads_, limits));
+    pool_ = make_unique<ThreadPool>(threads_, numa);
+}
+
+ConvertEngine::~ConvertEngine() {
+    wait();
+}
+
+void ConvertEngine::submit(ConvertJob job, Callback on_complete) {
+    {
+        lock_guard<mutex> lock(pending_mutex_);
+        pending_++;
+    }
+    pool_->enqueue([this, job = std::move(job), on_complete = std::move(on_complete)]() mutable {
+        ConvertResult result;
+        if (cancelled_.load(memory_order_relaxed)) {
+            result.cancelled = true;
+            result.error = "cancelled";
+        }
+        else {
+            result = convert(job);
+        }
+        if (on_complete) {
+            try {
+                on_complete(job, result);
+            }
+            catch (...) {
+                // A throwing callback must not take down the worker thread.
+            }
+        }
+
+        lock_guard<mutex> lock(pending_mutex_);
+        if (--pending_ == 0) idle_.notify_all();
+    });
+}
+
+future<ConvertResult> ConvertEngine::submit(ConvertJob job) {
+    auto promise = make_shared<std::promise<ConvertResult>>();
+    future<ConvertResult> result = promise->get_future();
+    submit(std::move(job), [promise](const ConvertJob&, ConvertResult& completed) {
+        promise->set_value(std::move(completed));
+    });
+    return result;
+}
+
+ConvertResult ConvertEngine::convert(const ConvertJob& job) {
+    ConvertResult result;
+    const trace::Span span("convert", job.input_path);
+    const auto start = chrono::steady_clock::now();
+    try {
+        if (job.input_data != nullptr || job.output_path.empty() || job.max_width != 0) {
+            // Caller-owned input is decoded where it lies; only files are read into a blob first.
+            const void* data = job.input_data;
+            size_t size = job.input_size;
+            Magick::Blob input;
+            if (data == nullptr) {
+                ScopedStage stage(Stage::Read, utils::get_extension(job.input_path));
+                input = read_blob(job.input_path);
+                data = input.data();
+                size = input.length();
+            }
+
+            string format = job.format;
+            if (format.empty() && !job.output_path.empty()) {
+                format = utils::get_extension(job.output_path);
+                if (!format.empty()) format.erase(0, 1);
+            }
+            result.output = convert_blob(data, size, format, job.quality, job.compression, job.scale, job.max_width);
+            result.input_bytes = size;
+            result.output_bytes = result.output.length();
+
+            if (!job.output_path.empty()) {
+                result.output_path = job.overwrite ? job.output_path : get_new_path(job.output_path);
+                ScopedStage stage(Stage::Write, format);
+                write_blob(result.output, result.output_path);
+            }
+        }
+        else {
+            result.output_path = convert_image(job.input_path, job.output_path, job.quality, job.compression,
+                job.scale, job.overwrite, job.format);
+            error_code ignored;
+            const auto input_bytes = filesystem::file_size(job.input_path, ignored);
+            const auto output_bytes = filesystem::file_size(result.output_path, ignored);
+            result.input_bytes = input_bytes == static_cast<uintmax_t>(-1) ? 0 : input_bytes;
+            result.output_bytes = output_bytes == static_cast<uintmax_t>(-1) ? 0 : output_bytes;
+        }
+        result.ok = true;
+    }
+    catch (const exception& e) {
+        result.error = e.what();
+    }
+    result.milliseconds = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count() / 1000.0;
+    return result;
+}
+
+void ConvertEngine::wait() {
+    unique_lock<mutex> lock(pending_mutex_);
+    idle_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void ConvertEngine::cancel() {
+    cancelled_.store(true, memory_order_relaxed);
+}
+
+bool ConvertEngine::cancelled() const {
+    return cancelled_.load(memory_order_relaxed);
+}
+
+unsigned int ConvertEngine::thread_count() const {
+    return threads_;
+}
+
+ThreadPool& ConvertEngine::pool() {
+    return *pool_;
+}
@@ -0,0 +1,321 @@
+#include "convertimg/Converter.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <spdlog/spdlog.h>
+
+#include "convertimg/ColorProfile.h"
+#include "convertimg/ResourceBudget.h"
+#include "convertimg/StageStats.h"
+#include "convertimg/ThreadPool.h"
+#include "convertimg/Utils.h"
+
+using namespace std;
+
+namespace {
+    string lower(string text) {
+        transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        return text;
+    }
+
+    // Formats whose frames are an animation, stored as partial frames drawn over each other.
+    bool is_animation(const string& format) {
+        const string name = lower(format);
+        return name == "gif" || name == "webp" || name == "apng" || name == "mng";
+    }
+
+    bool supports_frames(const string& format) {
+        try {
+            return Magick::CoderInfo(format).isMultiFrame();
+        }
+        catch (const Magick::Exception&) {
+            return false;
+        }
+    }
+
+    // Every frame or page of the encoded image at `data`. `path` (may be empty) gives ImageMagick its
+    // extension hint for formats it cannot detect from magic bytes. Decodes straight from `data`
+    // (what Magick::readImages does after copying it into a Blob), so borrowed buffers are not copied.
+    vector<Magick::Image> read_frames(const void* data, const size_t size, const string& path) {
+        Magick::ReadOptions options;
+        if (!path.empty()) MagickCore::CopyMagickString(options.imageInfo()->filename, path.c_str(), MagickPathExtent);
+        vector<Magick::Image> frames;
+        const unique_ptr<MagickCore::ExceptionInfo, decltype(&MagickCore::DestroyExceptionInfo)> exception(
+            MagickCore::AcquireExceptionInfo(), &MagickCore::DestroyExceptionInfo);
+        Magick::insertImages(&frames, MagickCore::BlobToImage(options.imageInfo(), data, size, exception.get()));
+        Magick::throwException(exception.get(), options.quiet());
+        if (frames.empty()) throw runtime_error("No image found");
+        return frames;
+    }
+
+    // Runs `work` for every frame, fanned out over the calling worker's pool when there is one.
+    void for_each_frame(const size_t count, const function<void(size_t)>& work) {
+        if (ThreadPool* pool = ThreadPool::current()) {
+            pool->parallel_for(count, work);
+            return;
+        }
+        for (size_t i = 0; i < count; i++) work(i);
+    }
+
+    // Converts `frames` to the target profile (see color::set_target_profile), then resizes and
+    // encodes them as `format`. Frames are transformed in parallel and reassembled
+    // in order; animations are coalesced first and layer-optimized again before encoding.
+    Magick::Blob encode_frames(
+        vector<Magick::Image>& frames, const int quality, const CompressionMode compression,
+        const double scale, const string& format)
+    {
+        // Single-frame outputs only ever held the first frame.
+        if (frames.size() > 1 && !supports_frames(format)) frames.resize(1);
+
+        if (color::has_target_profile()) {
+            ScopedStage stage(Stage::Color, format);
+            for_each_frame(frames.size(), [&](const size_t i) { color::to_target(frames[i]); });
+        }
+
+        Magick::Blob output;
+        if (frames.size() == 1) {
+            Magick::Image& image = frames.front();
+            {
+                ScopedStage stage(Stage::Resize, format);
+                transform_image(image, quality, compression, scale, "." + format);
+            }
+            ScopedStage stage(Stage::Encode, format);
+            if (!format.empty()) image.magick(format);
+            image.write(&output);
+            return output;
+        }
+
+        const bool animation = is_animation(frames.front().magick());
+        {
+            ScopedStage stage(Stage::Resize, format);
+            if (animation) {
+                vector<Magick::Image> coalesced;
+                Magick::coalesceImages(&coalesced, frames.begin(), frames.end());
+                frames.swap(coalesced);
+            }
+
+            // Compression is resolved once, so its warnings are not repeated for every frame.
+            set_compression(frames.front(), "." + format, compression);
+            const Magick::CompressionType compress_type = frames.front().compressType();
+            const bool quantize = lower(format) == "gif";
+            for_each_frame(frames.size(), [&](const size_t i) {
+                Magick::Image& frame = frames[i];
+                frame.scale(Magick::Geometry(frame.columns() * scale, frame.rows() * scale));
+                frame.quality(quality);
+                frame.compressType(compress_type);
+                if (quantize) {
+                    // Done here rather than one frame after another in the encoder.
+                    frame.quantizeColors(256);
+                    frame.quantize();
+                }
+                if (!format.empty()) frame.magick(format);
+            });
+        }
+
+        ScopedStage stage(Stage::Encode, format);
+        if (animation && is_animation(format)) {
+            vector<Magick::Image> optimized;
+            Magick::optimizeImageLayers(&optimized, frames.begin(), frames.end());
+            frames.swap(optimized);
+        }
+        Magick::writeImages(frames.begin(), frames.end(), &output, true);
+        return output;
+    }
+}
+
+CompressionMode get_compression_mode(const string& mode) {
+    if (mode == "lossy") return CompressionMode::Lossy;
+    if (mode == "lossless") return CompressionMode::Lossless;
+    return CompressionMode::None;
+}
+
+void set_compression(Magick::Image& image, const string& output_ext, const CompressionMode mode) {
+    if (mode == CompressionMode::None) return;
+
+    if (output_ext == ".png") {
+        // Magick++ doesn't have a direct lossy compression for PNG.
+        if (mode == CompressionMode::Lossy)
+        {
+        	spdlog::warn("Lossy compression is not supported for PNG. Using lossless compression instead.");
+		}
+        image.compressType(Magick::LZWCompression);
+    }
+    else if (output_ext == ".jpeg" || output_ext == ".jpg")
+    {
+    	if (mode == CompressionMode::Lossless)
+    	{
+    		spdlog::warn("Lossless compression is not supported for JPEG. Using lossy compression instead.");
+    	}
+    	image.compressType(Magick::JPEGCompression);
+    }
+    else if (output_ext == ".tiff" || output_ext == ".tif") {
+        if (mode == CompressionMode::Lossy) {
+            image.compressType(Magick::JPEGCompression);
+        }
+        else if (mode == CompressionMode::Lossless) {
+            image.compressType(Magick::LZWCompression);
+        }
+    }
+    else if (output_ext == ".webp") {
+        if (mode == CompressionMode::Lossy) {
+            image.compressType(Magick::JPEGCompression);
+        }
+        else if (mode == CompressionMode::Lossless) {
+            image.compressType(Magick::LZWCompression);
+        }
+    }
+    else if (output_ext == ".heif")
+    {
+	    if (mode == CompressionMode::Lossy)
+	    {
+	    	image.compressType(Magick::JPEGCompression);
+		}
+        else if (mode == CompressionMode::Lossless)
+        {
+        	image.compressType(Magick::LZWCompression);
+		}
+    }
+    else
+    {
+    	spdlog::warn("Compression mode is not supported for {} files. Using LZW compression (default) instead.", output_ext);
+	}
+}
+
+string get_new_path(const string& base_path) {
+    string new_path = base_path;
+    int count = 1;
+    while (filesystem::exists(new_path))
+    {
+        new_path = base_path.substr(0, base_path.find_last_of('.')) + "_" + to_string(count) + base_path.substr(base_path.find_last_of('.'));
+        count++;
+    }
+    return new_path;
+}
+
+string make_output_path(const string& input_path, const string& output_dir, const string& output_ext) {
+    return (filesystem::path(output_dir) / (filesystem::path(input_path).stem().string() + "." + output_ext)).string();
+}
+
+void transform_image(
+    Magick::Image& image, const int quality, const CompressionMode compression,
+    const double scale, const string& output_ext)
+{
+    image.scale(Magick::Geometry(image.columns() * scale, image.rows() * scale));
+    image.quality(quality);
+
+    set_compression(image, output_ext, compression);
+}
+
+Magick::Blob read_blob(const string& path) {
+    ifstream file(path, ios::binary | ios::ate);
+    if (!file) throw runtime_error("Failed to open " + utils::quote(path));
+    const streamsize size = file.tellg();
+    file.seekg(0);
+
+    char* data = new char[static_cast<size_t>(size)];
+    if (!file.read(data, size)) {
+        delete[] data;
+        throw runtime_error("Failed to read " + utils::quote(path));
+    }
+    Magick::Blob blob;
+    blob.updateNoCopy(data, static_cast<size_t>(size));
+    return blob;
+}
+
+void write_blob(const Magick::Blob& blob, const string& path) {
+    // Written next to the target and renamed into place, so `path` never holds a partial image.
+    const string partial = path + ".part";
+    {
+        ofstream file(partial, ios::binary);
+        file.write(static_cast<const char*>(blob.data()), static_cast<streamsize>(blob.length()));
+        if (!file) {
+            file.close();
+            error_code ignored;
+            filesystem::remove(partial, ignored);
+            throw runtime_error("Failed to write " + utils::quote(path));
+        }
+    }
+    error_code error;
+    filesystem::rename(partial, path, error);
+    if (error) {
+        const string reason = error.message();
+        filesystem::remove(partial, error);
+        throw runtime_error("Failed to write " + utils::quote(path) + ": " + reason);
+    }
+}
+
+Magick::Blob convert_blob(
+    const Magick::Blob& input, const string& output_format,
+    const int quality, const CompressionMode compression,
+    const double scale, const size_t max_width)
+{
+    return convert_blob(input.data(), input.length(), output_format, quality, compression, scale, max_width);
+}
+
+Magick::Blob convert_blob(
+    const void* data, const size_t size, const string& output_format,
+    const int quality, const CompressionMode compression,
+    double scale, const size_t max_width)
+{
+    try
+    {
+        vector<Magick::Image> frames;
+        {
+            ScopedStage stage(Stage::Decode);
+            frames = read_frames(data, size, "");
+            stage.set_format(frames.front().magick());
+        }
+        const Magick::Image& first = frames.front();
+        resources::note_pixel_cache(first, "<blob>");
+        if (max_width != 0 && first.columns() != 0) {
+            scale = min(scale, static_cast<double>(max_width) / first.columns());
+        }
+
+        const string format = lower(output_format.empty() ? first.magick() : output_format);
+        return encode_frames(frames, quality, compression, scale, format);
+    }
+    catch (Magick::Exception& e) {
+        throw runtime_error("Magick++ exception: " + string(e.what()));
+    }
+}
+
+string convert_image(
+    const string& input_path, const string& output_path,
+    const int quality, const CompressionMode compression,
+    const double scale, const bool overwrite, const string& format)
+{
+    spdlog::debug("Converting image: {} -> {}", utils::quote(input_path), utils::quote(output_path));
+
+    try 
+    {
+        const string input_ext = utils::get_extension(input_path);
+        vector<Magick::Image> frames;
+        {
+            Magick::Blob input;
+            {
+                ScopedStage stage(Stage::Read, input_ext);
+                input = read_blob(input_path);
+            }
+            ScopedStage stage(Stage::Decode, input_ext);
+            frames = read_frames(input.data(), input.length(), input_path);
+        }
+        resources::note_pixel_cache(frames.front(), input_path);
+
+        string output_format = format;
+        if (output_format.empty()) {
+            output_format = utils::get_extension(output_path);
+            if (!output_format.empty()) output_format.erase(0, 1);
+        }
+        const Magick::Blob output = encode_frames(frames, quality, compression, scale, output_format);
+
+        const string output_path_to_use = overwrite ? output_path : get_new_path(output_path);
+        ScopedStage stage(Stage::Write, output_format);
+        write_blob(output, output_path_to_use);
+        return output_path_to_use;
+    }
+    catch (Magick::Exception& e) {
+        throw runtime_error("Magick++ exception: " + string(e.what()));
+    }
+}
@@ -0,0 +1,136 @@
+#include "convertimg/FormatSniff.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+    struct Signature {
+        const char* format;
+        size_t offset;
+        string_view magic;  // '?' matches any byte
+    };
+
+    using namespace std::string_view_literals;
+
+    // Longer, more specific signatures first where one is a prefix of another.
+    constexpr Signature signatures[] = {
+        { "jpeg", 0, "\xFF\xD8\xFF"sv },
+        { "png", 0, "\x89PNG\r\n\x1A\n"sv },
+        { "mng", 0, "\x8AMNG\r\n\x1A\n"sv },
+        { "jng", 0, "\x8BJNG\r\n\x1A\n"sv },
+        { "gif", 0, "GIF87a"sv },
+        { "gif", 0, "GIF89a"sv },
+        { "webp", 0, "RIFF????WEBP"sv },
+        { "orf", 0, "IIRO"sv },
+        { "rw2", 0, "IIU\0"sv },
+        { "cr2", 0, "II*\0????CR\x02"sv },
+        { "tiff", 0, "II*\0"sv },   // also TIFF-based raws without a signature of their own (see detect_file)
+        { "tiff", 0, "MM\0*"sv },
+        { "tiff", 0, "II+\0"sv },   // BigTIFF
+        { "tiff", 0, "MM\0+"sv },
+        { "avif", 4, "ftypavif"sv },
+        { "avif", 4, "ftypavis"sv },
+        { "heic", 4, "ftypheic"sv },
+        { "heic", 4, "ftypheix"sv },
+        { "heic", 4, "ftyphevc"sv },
+        { "cr3", 4, "ftypcrx "sv },
+        { "jxl", 0, "\xFF\x0A"sv },
+        { "jxl", 0, "\0\0\0\x0CJXL \r\n\x87\n"sv },
+        { "jp2", 0, "\0\0\0\x0CjP  \r\n\x87\n"sv },
+        { "j2k", 0, "\xFF\x4F\xFF\x51"sv },
+        { "raf", 0, "FUJIFILMCCD-RAW"sv },
+        { "psd", 0, "8BPS"sv },
+        { "xcf", 0, "gimp xcf"sv },
+        { "exr", 0, "\x76\x2F\x31\x01"sv },
+        { "hdr", 0, "#?RADIANCE"sv },
+        { "hdr", 0, "#?RGBE"sv },
+        { "dds", 0, "DDS "sv },
+        { "qoi", 0, "qoif"sv },
+        { "ico", 0, "\0\0\x01\0"sv },
+        { "fits", 0, "SIMPLE  ="sv },
+        { "bmp", 0, "BM"sv },
+    };
+
+    bool matches(const Signature& signature, const unsigned char* header, const size_t size) {
+        if (signature.offset + signature.magic.size() > size) return false;
+        for (size_t i = 0; i < signature.magic.size(); i++) {
+            if (signature.magic[i] != '?' && static_cast<unsigned char>(signature.magic[i]) != header[signature.offset + i]) return false;
+        }
+        return true;
+    }
+
+    // Raw formats stored as an ordinary TIFF container, told apart only by their extension.
+    bool is_tiff_based_raw(const string& canonical) {
+        return canonical == "dng" || canonical == "nef" || canonical == "nrw" || canonical == "arw" || canonical == "sr2" ||
+            canonical == "srf" || canonical == "pef" || canonical == "srw" || canonical == "erf" || canonical == "kdc" ||
+            canonical == "3fr" || canonical == "mef" || canonical == "mos" || canonical == "iiq";
+    }
+
+    // Files with the generic HEIF major brands ("mif1", "msf1") hold AVIF as often as HEVC; the
+    // compatible brands that follow in the ftyp box say which. Empty when the header is not such a box.
+    string detect_heif_brand(const unsigned char* header, const size_t size) {
+        if (size < 16) return "";
+        const string_view major(reinterpret_cast<const char*>(header) + 4, 8);
+        if (major != "ftypmif1" && major != "ftypmsf1") return "";
+        const uint32_t box_size = uint32_t(header[0]) << 24 | uint32_t(header[1]) << 16 | uint32_t(header[2]) << 8 | header[3];
+        for (size_t offset = 16; offset + 4 <= min<size_t>(box_size, size); offset += 4) {
+            const string_view brand(reinterpret_cast<const char*>(header) + offset, 4);
+            if (brand == "avif" || brand == "avis") return "avif";
+        }
+        return "heic";
+    }
+
+    string lower(string text) {
+        transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        return text;
+    }
+}
+
+string sniff::detect(const unsigned char* header, const size_t size) {
+    if (string format = detect_heif_brand(header, size); !format.empty()) return format;
+    for (const Signature& signature : signatures) {
+        if (matches(signature, header, size)) return signature.format;
+    }
+    // Netpbm: "P1".."P7" followed by whitespace.
+    if (size >= 3 && header[0] == 'P' && header[1] >= '1' && header[1] <= '7' && isspace(header[2])) return "pnm";
+    return "";
+}
+
+string sniff::detect_file(const string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return "";
+    unsigned char header[header_bytes];
+    const size_t size = fread(header, 1, sizeof(header), file);
+    fclose(file);
+    const string format = detect(header, size);
+    if (format == "tiff") {
+        const string named = canonical_format(filesystem::path(path).extension().string());
+        if (is_tiff_based_raw(named)) return named;
+    }
+    return format;
+}
+
+string sniff::canonical_format(const string& name) {
+    string format = lower(name);
+    if (!format.empty() && format[0] == '.') format.erase(0, 1);
+    if (format == "jpg" || format == "jpe" || format == "jfif" || format == "pjpeg") return "jpeg";
+    if (format == "tif") return "tiff";
+    if (format == "heif" || format == "hif") return "heic";
+    if (format == "pbm" || format == "pgm" || format == "ppm" || format == "pam") return "pnm";
+    if (format == "apng") return "png";
+    if (format == "jpf" || format == "jpx") return "jp2";
+    if (format == "j2c" || format == "jpc") return "j2k";
+    if (format == "svgz") return "svg";
+    if (format == "targa") return "tga";
+    return format;
+}
+
+bool sniff::is_headerless_format(const string& canonical) {
+    return canonical == "tga" || canonical == "svg" || canonical == "pcx" || canonical == "wbmp";
+}
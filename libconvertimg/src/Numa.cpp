@@ -0,0 +1,130 @@
+#include "convertimg/Numa.h"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+    NumaNode single_node() {
+        NumaNode node;
+        for (unsigned int cpu = 0; cpu < max(thread::hardware_concurrency(), 1u); cpu++) node.cpus.push_back(cpu);
+        return node;
+    }
+
+#ifdef __linux__
+    // Parses a sysfs CPU list such as "0-7,16-23".
+    vector<unsigned int> parse_cpu_list(const string& text) {
+        vector<unsigned int> cpus;
+        size_t position = 0;
+        while (position < text.size()) {
+            size_t end = text.find(',', position);
+            if (end == string::npos) end = text.size();
+            const string range = text.substr(position, end - position);
+            position = end + 1;
+            if (range.empty()) continue;
+            try {
+                const size_t dash = range.find('-');
+                const unsigned long first = stoul(range.substr(0, dash));
+                const unsigned long last = dash == string::npos ? first : stoul(range.substr(dash + 1));
+                for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) cpus.push_back(static_cast<unsigned int>(cpu));
+            }
+            catch (const exception&) {
+            }
+        }
+        return cpus;
+    }
+#endif
+}
+
+vector<NumaNode> numa::topology() {
+    vector<NumaNode> nodes;
+#ifdef _WIN32
+    DWORD length = 0;
+    GetLogicalProcessorInformationEx(RelationNumaNode, nullptr, &length);
+    vector<char> buffer(length);
+    auto* info = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data());
+    if (length != 0 && GetLogicalProcessorInformationEx(RelationNumaNode, info, &length)) {
+        for (DWORD offset = 0; offset < length;) {
+            const auto* entry = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+            NumaNode node;
+            node.id = entry->NumaNode.NodeNumber;
+            const GROUP_AFFINITY& affinity = entry->NumaNode.GroupMask;
+            for (unsigned int bit = 0; bit < 64; bit++) {
+                if (affinity.Mask & (KAFFINITY(1) << bit)) node.cpus.push_back(affinity.Group * 64u + bit);
+            }
+            if (!node.cpus.empty()) nodes.push_back(std::move(node));
+            offset += entry->Size;
+        }
+    }
+#elif defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    const bool have_allowed = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    error_code error;
+    for (const auto& entry : filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        const string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.size() == 4 || !all_of(name.begin() + 4, name.end(), [](unsigned char c) { return isdigit(c); })) continue;
+
+        ifstream file(entry.path() / "cpulist");
+        string list;
+        getline(file, list);
+        NumaNode node;
+        node.id = static_cast<unsigned int>(stoul(name.substr(4)));
+        for (const unsigned int cpu : parse_cpu_list(list)) {
+            // Only the CPUs of our cpuset, e.g. a container limited to one socket.
+            if (!have_allowed || CPU_ISSET(cpu, &allowed)) node.cpus.push_back(cpu);
+        }
+        if (!node.cpus.empty()) nodes.push_back(std::move(node));
+    }
+#endif
+    if (nodes.empty()) nodes.push_back(single_node());
+    sort(nodes.begin(), nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    return nodes;
+}
+
+bool numa::pin_current_thread(const vector<unsigned int>& cpus) {
+    if (cpus.empty()) return false;
+#ifdef _WIN32
+    // A thread runs in one processor group; nodes never span groups.
+    GROUP_AFFINITY affinity{};
+    affinity.Group = static_cast<WORD>(cpus.front() / 64);
+    for (const unsigned int cpu : cpus) {
+        if (cpu / 64 == affinity.Group) affinity.Mask |= KAFFINITY(1) << (cpu % 64);
+    }
+    return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const unsigned int cpu : cpus) {
+        if (cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+void numa::prefer_local_memory() {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    // MPOL_LOCAL from <numaif.h>, without depending on libnuma.
+    constexpr int mpol_local = 4;
+    syscall(SYS_set_mempolicy, mpol_local, nullptr, 0);
+#endif
+    // Windows already allocates from the node of the thread's ideal processor.
+}
@@ -0,0 +1,288 @@
+#include "convertimg/PixelPool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+#include <Magick++.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+namespace {
+    // Every block handed out starts with this header, right before the returned pointer.
+    enum class Kind : uint16_t { Heap, HeapAligned, Mapped };
+
+    struct Header {
+        Kind kind;
+        uint16_t size_class;
+        uint32_t prefix;    // bytes between the start of the allocation and the returned pointer
+        uint64_t capacity;  // usable bytes after the returned pointer
+    };
+    static_assert(sizeof(Header) == 16, "the header must keep heap blocks 16-byte aligned");
+
+    constexpr size_t mapped_prefix = 64;  // keeps mapped blocks cache-line aligned
+    constexpr unsigned int min_class_shift = 12;
+    constexpr unsigned int max_class_shift = 40;
+    constexpr size_t class_count = (max_class_shift - min_class_shift) * 4;
+    constexpr size_t blocks_per_thread = 4;  // per size class
+    constexpr size_t huge_page = 2 << 20;
+
+    PixelPoolOptions options;
+    atomic<bool> active{ false };
+
+    atomic<uint64_t> allocations{ 0 };
+    atomic<uint64_t> thread_hits{ 0 };
+    atomic<uint64_t> shared_hits{ 0 };
+    atomic<uint64_t> fresh_mappings{ 0 };
+    atomic<uint64_t> mapped_bytes{ 0 };
+    atomic<uint64_t> peak_mapped_bytes{ 0 };
+    atomic<uint64_t> idle_bytes{ 0 };
+
+    Header* header_of(void* memory) {
+        return static_cast<Header*>(memory) - 1;
+    }
+
+    // Four classes per power of two (1, 1.25, 1.5, 1.75 x 2^e) bound the rounding waste to 25%.
+    size_t class_of(const size_t bytes) {
+        unsigned int shift = min_class_shift;
+        while (shift < max_class_shift && (size_t(1) << (shift + 1)) < bytes) shift++;
+        if (bytes <= (size_t(1) << shift)) return (shift - min_class_shift) * 4;
+        const size_t base = size_t(1) << shift;
+        const size_t step = (bytes - base + (base / 4) - 1) / (base / 4);  // 1..4
+        return (shift - min_class_shift) * 4 + step;
+    }
+
+    size_t class_bytes(const size_t size_class) {
+        const size_t base = size_t(1) << (min_class_shift + size_class / 4);
+        return base + (base / 4) * (size_class % 4);
+    }
+
+    void* map_block(const size_t bytes) {
+#ifdef _WIN32
+        return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+        void* block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+        if (options.huge_pages && bytes >= huge_page) madvise(block, bytes, MADV_HUGEPAGE);
+#endif
+        return block;
+#endif
+    }
+
+    void unmap_block(void* block, const size_t bytes) {
+#ifdef _WIN32
+        VirtualFree(block, 0, MEM_RELEASE);
+#else
+        munmap(block, bytes);
+#endif
+        mapped_bytes.fetch_sub(bytes, memory_order_relaxed);
+    }
+
+    // Blocks given back by threads whose own cache was full, or that exited.
+    struct SharedPool {
+        mutex lock;
+        array<vector<void*>, class_count> blocks;
+    };
+
+    SharedPool& shared_pool() {
+        static SharedPool* pool = new SharedPool();  // never destroyed: threads may exit after static destruction
+        return *pool;
+    }
+
+    // Trivially destructible, so still readable while the thread's other thread_locals are destroyed.
+    thread_local bool thread_cache_gone = false;
+
+    struct ThreadCache {
+        array<vector<void*>, class_count> blocks;
+
+        ~ThreadCache() {
+            thread_cache_gone = true;
+            SharedPool& pool = shared_pool();
+            lock_guard<mutex> lock(pool.lock);
+            for (size_t c = 0; c < class_count; c++) {
+                pool.blocks[c].insert(pool.blocks[c].end(), blocks[c].begin(), blocks[c].end());
+            }
+        }
+    };
+
+    // Null once the thread is exiting: ImageMagick's thread-specific data is freed after thread_locals.
+    ThreadCache* thread_cache() {
+        if (thread_cache_gone) return nullptr;
+        thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    void* acquire_mapped(const size_t size) {
+        const size_t size_class = class_of(size + mapped_prefix);
+        if (size_class >= class_count) return nullptr;
+        allocations.fetch_add(1, memory_order_relaxed);
+        const size_t bytes = class_bytes(size_class);
+
+        void* block = nullptr;
+        ThreadCache* cache = thread_cache();
+        if (cache != nullptr && !cache->blocks[size_class].empty()) {
+            block = cache->blocks[size_class].back();
+            cache->blocks[size_class].pop_back();
+            thread_hits.fetch_add(1, memory_order_relaxed);
+        }
+        else {
+            SharedPool& pool = shared_pool();
+            lock_guard<mutex> lock(pool.lock);
+            if (!pool.blocks[size_class].empty()) {
+                block = pool.blocks[size_class].back();
+                pool.blocks[size_class].pop_back();
+                shared_hits.fetch_add(1, memory_order_relaxed);
+            }
+        }
+        if (block != nullptr) {
+            idle_bytes.fetch_sub(bytes, memory_order_relaxed);
+        }
+        else {
+            block = map_block(bytes);
+            if (block == nullptr) return nullptr;
+            fresh_mappings.fetch_add(1, memory_order_relaxed);
+            const uint64_t now = mapped_bytes.fetch_add(bytes, memory_order_relaxed) + bytes;
+            uint64_t peak = peak_mapped_bytes.load(memory_order_relaxed);
+            while (now > peak && !peak_mapped_bytes.compare_exchange_weak(peak, now, memory_order_relaxed)) {}
+        }
+
+        void* memory = static_cast<char*>(block) + mapped_prefix;
+        *header_of(memory) = { Kind::Mapped, static_cast<uint16_t>(size_class), mapped_prefix, bytes - mapped_prefix };
+        return memory;
+    }
+
+    void release_mapped(void* memory, const Header& header) {
+        void* block = static_cast<char*>(memory) - header.prefix;
+        const size_t bytes = class_bytes(header.size_class);
+
+        // Keep the block for reuse unless the idle budget is spent.
+        uint64_t idle = idle_bytes.load(memory_order_relaxed);
+        do {
+            if (idle + bytes > options.max_idle_bytes) {
+                unmap_block(block, bytes);
+                return;
+            }
+        } while (!idle_bytes.compare_exchange_weak(idle, idle + bytes, memory_order_relaxed));
+
+        ThreadCache* cache = thread_cache();
+        if (cache != nullptr && cache->blocks[header.size_class].size() < blocks_per_thread) {
+            cache->blocks[header.size_class].push_back(block);
+            return;
+        }
+        SharedPool& pool = shared_pool();
+        lock_guard<mutex> lock(pool.lock);
+        pool.blocks[header.size_class].push_back(block);
+    }
+
+    void* acquire_heap(const size_t size) {
+        void* block = malloc(size + sizeof(Header));
+        if (block == nullptr) return nullptr;
+        void* memory = static_cast<char*>(block) + sizeof(Header);
+        *header_of(memory) = { Kind::Heap, 0, sizeof(Header), size };
+        return memory;
+    }
+
+    void* acquire(const size_t size) {
+        if (size >= options.min_block) {
+            if (void* memory = acquire_mapped(size)) return memory;
+        }
+        return acquire_heap(size);
+    }
+
+    void release(void* memory) {
+        if (memory == nullptr) return;
+        const Header header = *header_of(memory);
+        void* block = static_cast<char*>(memory) - header.prefix;
+        switch (header.kind) {
+        case Kind::Heap:
+            free(block);
+            break;
+        case Kind::HeapAligned:
+#ifdef _WIN32
+            _aligned_free(block);
+#else
+            free(block);
+#endif
+            break;
+        case Kind::Mapped:
+            release_mapped(memory, header);
+            break;
+        }
+    }
+
+    void* resize(void* memory, const size_t size) {
+        if (memory == nullptr) return acquire(size);
+        const Header header = *header_of(memory);
+        if (size <= header.capacity) return memory;
+
+        // Small heap blocks that stay small grow in place where the heap can.
+        if (header.kind == Kind::Heap && size < options.min_block) {
+            void* block = realloc(static_cast<char*>(memory) - sizeof(Header), size + sizeof(Header));
+            if (block == nullptr) return nullptr;
+            void* moved = static_cast<char*>(block) + sizeof(Header);
+            header_of(moved)->capacity = size;
+            return moved;
+        }
+
+        void* moved = acquire(size);
+        if (moved == nullptr) return nullptr;  // the caller still owns `memory`
+        memcpy(moved, memory, min<uint64_t>(header.capacity, size));
+        release(memory);
+        return moved;
+    }
+
+    void* acquire_aligned(const size_t size, const size_t alignment) {
+        if (alignment <= mapped_prefix && size >= options.min_block) {
+            if (void* memory = acquire_mapped(size)) return memory;
+        }
+        const size_t prefix = max(alignment, max<size_t>(mapped_prefix, sizeof(Header)));
+#ifdef _WIN32
+        void* block = _aligned_malloc(size + prefix, prefix);
+        if (block == nullptr) return nullptr;
+#else
+        void* block = nullptr;
+        if (posix_memalign(&block, prefix, size + prefix) != 0) return nullptr;
+#endif
+        void* memory = static_cast<char*>(block) + prefix;
+        *header_of(memory) = { Kind::HeapAligned, 0, static_cast<uint32_t>(prefix), size };
+        return memory;
+    }
+}
+
+bool pixel_pool::install(const PixelPoolOptions& pool_options) {
+    if (active.load() || MagickCore::IsMagickCoreInstantiated() == MagickCore::MagickTrue) return false;
+    options = pool_options;
+    options.min_block = max<size_t>(options.min_block, size_t(1) << min_class_shift);
+    MagickCore::SetMagickMemoryMethods(acquire, resize, release);
+    MagickCore::SetMagickAlignedMemoryMethods(acquire_aligned, release);
+    active = true;
+    return true;
+}
+
+bool pixel_pool::installed() {
+    return active.load();
+}
+
+PixelPoolStats pixel_pool::stats() {
+    PixelPoolStats stats;
+    stats.allocations = allocations.load(memory_order_relaxed);
+    stats.thread_hits = thread_hits.load(memory_order_relaxed);
+    stats.shared_hits = shared_hits.load(memory_order_relaxed);
+    stats.fresh_mappings = fresh_mappings.load(memory_order_relaxed);
+    stats.mapped_bytes = mapped_bytes.load(memory_order_relaxed);
+    stats.peak_mapped_bytes = peak_mapped_bytes.load(memory_order_relaxed);
+    stats.idle_bytes = idle_bytes.load(memory_order_relaxed);
+    return stats;
+}
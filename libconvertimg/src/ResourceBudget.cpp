@@ -0,0 +1,161 @@
+#include "convertimg/ResourceBudget.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include <Magick++.h>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+    atomic<uint64_t> map_spills{ 0 };
+    atomic<uint64_t> disk_spills{ 0 };
+
+    // Returns 0 when the file is missing or holds "max" (no limit).
+    uint64_t read_cgroup_limit(const string& path) {
+        ifstream file(path);
+        string value;
+        if (!(file >> value) || value == "max") return 0;
+        try {
+            return stoull(value);
+        }
+        catch (const exception&) {
+            return 0;
+        }
+    }
+
+    uint64_t cgroup_memory_max() {
+        // cgroup v2 exposes a single "0::/<path>" line in /proc/self/cgroup.
+        ifstream self("/proc/self/cgroup");
+        string line;
+        while (getline(self, line)) {
+            if (line.rfind("0::", 0) != 0) continue;
+            const uint64_t limit = read_cgroup_limit("/sys/fs/cgroup" + line.substr(3) + "/memory.max");
+            if (limit != 0) return limit;
+        }
+        // Inside a container the namespace root is usually mounted directly.
+        return read_cgroup_limit("/sys/fs/cgroup/memory.max");
+    }
+
+    uint64_t physical_memory() {
+#ifdef _WIN32
+        MEMORYSTATUSEX status{};
+        status.dwLength = sizeof(status);
+        return GlobalMemoryStatusEx(&status) ? status.ullTotalPhys : 0;
+#else
+        const long pages = sysconf(_SC_PHYS_PAGES);
+        const long page_size = sysconf(_SC_PAGESIZE);
+        return pages > 0 && page_size > 0 ? static_cast<uint64_t>(pages) * page_size : 0;
+#endif
+    }
+}  // namespace
+
+namespace resources {
+    uint64_t parse_size(const string& text) {
+        size_t pos = 0;
+        double value;
+        try {
+            value = stod(text, &pos);
+        }
+        catch (const exception&) {
+            throw invalid_argument("Invalid size: " + text);
+        }
+        if (value < 0) throw invalid_argument("Invalid size: " + text);
+
+        string unit = text.substr(pos);
+        transform(unit.begin(), unit.end(), unit.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        unit.erase(remove(unit.begin(), unit.end(), ' '), unit.end());
+
+        double multiplier;
+        if (unit.empty() || unit == "b") multiplier = 1;
+        else if (unit == "k" || unit == "kb" || unit == "kib") multiplier = 1024.0;
+        else if (unit == "m" || unit == "mb" || unit == "mib") multiplier = 1024.0 * 1024;
+        else if (unit == "g" || unit == "gb" || unit == "gib") multiplier = 1024.0 * 1024 * 1024;
+        else if (unit == "t" || unit == "tb" || unit == "tib") multiplier = 1024.0 * 1024 * 1024 * 1024;
+        else throw invalid_argument("Invalid size unit: " + text);
+        return static_cast<uint64_t>(value * multiplier);
+    }
+
+    string format_size(const uint64_t bytes) {
+        const char* units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+        double value = static_cast<double>(bytes);
+        int unit = 0;
+        while (value >= 1024 && unit < 4) {
+            value /= 1024;
+            unit++;
+        }
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.1f%s", value, units[unit]);
+        return buffer;
+    }
+
+    uint64_t detect_memory_limit() {
+        const uint64_t physical = physical_memory();
+        const uint64_t cgroup = cgroup_memory_max();
+        if (cgroup != 0 && (physical == 0 || cgroup < physical)) return cgroup;
+        return physical;
+    }
+
+    ResourceBudget derive_budget(unsigned int workers, const ResourceBudget& overrides) {
+        workers = max(workers, 1u);
+        ResourceBudget budget;
+
+        const uint64_t available = detect_memory_limit();
+        if (available != 0) {
+            // Keep a quarter back for coder buffers, encoded blobs and the process itself.
+            const uint64_t usable = available / 4 * 3;
+            budget.memory = usable;
+            budget.map = usable * 2;
+
+            // Area is a per-image limit: give each concurrent job an equal slice of the heap.
+            const uint64_t bytes_per_pixel = sizeof(Magick::Quantum) * 4;
+            budget.area = usable / workers / bytes_per_pixel;
+        }
+
+        if (overrides.memory) budget.memory = overrides.memory;
+        if (overrides.map) budget.map = overrides.map;
+        if (overrides.disk) budget.disk = overrides.disk;
+        if (overrides.area) budget.area = overrides.area;
+        return budget;
+    }
+
+    void apply(const ResourceBudget& budget) {
+        if (budget.memory) Magick::ResourceLimits::memory(budget.memory);
+        if (budget.map) Magick::ResourceLimits::map(budget.map);
+        if (budget.disk) Magick::ResourceLimits::disk(budget.disk);
+        if (budget.area) Magick::ResourceLimits::area(budget.area);
+
+        spdlog::debug("Resource limits: memory={}, map={}, disk={}, area={} pixels",
+            format_size(Magick::ResourceLimits::memory()), format_size(Magick::ResourceLimits::map()),
+            format_size(Magick::ResourceLimits::disk()), Magick::ResourceLimits::area());
+    }
+
+    void note_pixel_cache(const Magick::Image& image, const string& path) {
+        switch (MagickCore::GetImagePixelCacheType(image.constImage())) {
+        case MagickCore::MapCache:
+            map_spills++;
+            spdlog::debug("Pixel cache of {} spilled to a memory-mapped file", path);
+            break;
+        case MagickCore::DiskCache:
+            disk_spills++;
+            spdlog::warn("Pixel cache of {} spilled to disk", path);
+            break;
+        default:
+            break;
+        }
+    }
+
+    SpillStats spill_stats() {
+        return { map_spills.load(), disk_spills.load() };
+    }
+}  // namespace resources
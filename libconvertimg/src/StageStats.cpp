@@ -0,0 +1,227 @@
+#include "convertimg/StageStats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include "convertimg/Trace.h"
+
+using namespace std;
+
+namespace {
+    constexpr size_t linear_buckets = 32;  // values below this get a bucket each
+    constexpr size_t sub_buckets = 16;     // buckets per power of two above that
+    constexpr size_t stage_count = static_cast<size_t>(Stage::Count);
+    constexpr size_t max_formats = 32;
+    constexpr size_t format_length = 15;
+
+    int highest_bit(uint64_t value) {
+        int bit = 0;
+        while (value >>= 1) bit++;
+        return bit;
+    }
+
+    // Single writer (the owning thread), any number of readers.
+    struct AtomicHistogram {
+        array<atomic<uint64_t>, Histogram::bucket_count> buckets{};
+
+        void record(const uint64_t value) {
+            auto& bucket = buckets[Histogram::bucket_of(value)];
+            bucket.store(bucket.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        }
+
+        void merge_into(Histogram& histogram) const {
+            for (size_t i = 0; i < buckets.size(); i++) {
+                const uint64_t count = buckets[i].load(memory_order_relaxed);
+                if (count != 0) histogram.add(i, count);
+            }
+        }
+    };
+
+    struct FormatSlot {
+        string name;
+        array<AtomicHistogram, stage_count> stages;
+    };
+
+    // One per recording thread. Slots are appended by the owner and published through `used`.
+    struct ThreadStats {
+        array<unique_ptr<FormatSlot>, max_formats> slots;
+        atomic<size_t> used{ 0 };
+        bool in_use = true;  // guarded by registry_mutex
+
+        FormatSlot& slot(const string& name) {
+            const size_t count = used.load(memory_order_relaxed);
+            for (size_t i = 0; i < count; i++) {
+                if (slots[i]->name == name) return *slots[i];
+            }
+            // Keep the last slot for whatever does not fit.
+            if (count == max_formats - 1 && name != "other") return slot("other");
+            if (count == max_formats) return *slots[count - 1];
+
+            slots[count] = make_unique<FormatSlot>();
+            slots[count]->name = name;
+            used.store(count + 1, memory_order_release);
+            return *slots[count];
+        }
+    };
+
+    mutex registry_mutex;
+    vector<unique_ptr<ThreadStats>> registry;
+
+    // Hands the thread's stats back for reuse when the thread exits, so thread-per-connection
+    // servers do not grow the registry without bound. The recorded samples are kept.
+    struct ThreadHandle {
+        ThreadStats* stats = nullptr;
+
+        ~ThreadHandle() {
+            if (stats == nullptr) return;
+            lock_guard<mutex> lock(registry_mutex);
+            stats->in_use = false;
+        }
+    };
+
+    ThreadStats& thread_stats() {
+        thread_local ThreadHandle handle;
+        if (handle.stats == nullptr) {
+            lock_guard<mutex> lock(registry_mutex);
+            for (const auto& stats : registry) {
+                if (!stats->in_use) {
+                    stats->in_use = true;
+                    handle.stats = stats.get();
+                    break;
+                }
+            }
+            if (handle.stats == nullptr) {
+                registry.push_back(make_unique<ThreadStats>());
+                handle.stats = registry.back().get();
+            }
+        }
+        return *handle.stats;
+    }
+
+    string normalize_format(string_view format) {
+        if (!format.empty() && format[0] == '.') format.remove_prefix(1);
+        string name(format.substr(0, format_length));
+        transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+        return name;
+    }
+}
+
+const char* stage_name(const Stage stage) {
+    switch (stage) {
+        case Stage::Enumerate: return "enumerate";
+        case Stage::Read: return "read";
+        case Stage::Decode: return "decode";
+        case Stage::Color: return "color";
+        case Stage::Resize: return "resize";
+        case Stage::Encode: return "encode";
+        case Stage::Write: return "write";
+        default: return "unknown";
+    }
+}
+
+size_t Histogram::bucket_of(uint64_t value) {
+    if (value < linear_buckets) return static_cast<size_t>(value);
+    value = min<uint64_t>(value, (uint64_t{ 1 } << 32) - 1);
+    const int shift = highest_bit(value) - 4;
+    return shift * sub_buckets + static_cast<size_t>(value >> shift);
+}
+
+uint64_t Histogram::value_of(const size_t bucket) {
+    if (bucket < linear_buckets) return bucket;
+    const size_t shift = bucket / sub_buckets - 1;
+    const uint64_t mantissa = bucket - shift * sub_buckets;
+    return (mantissa << shift) + ((uint64_t{ 1 } << shift) >> 1);
+}
+
+void Histogram::record(const uint64_t value) {
+    add(bucket_of(value), 1);
+}
+
+void Histogram::add(const size_t bucket, const uint64_t count) {
+    buckets_[bucket] += count;
+    count_ += count;
+    sum_ += value_of(bucket) * count;
+    max_ = std::max(max_, value_of(bucket));
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (size_t i = 0; i < bucket_count; i++) buckets_[i] += other.buckets_[i];
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t Histogram::percentile(const double fraction) const {
+    if (count_ == 0) return 0;
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * count_ + 0.999999));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < bucket_count; i++) {
+        seen += buckets_[i];
+        if (seen >= rank) return value_of(i);
+    }
+    return max_;
+}
+
+uint64_t Histogram::count() const {
+    return count_;
+}
+
+uint64_t Histogram::max() const {
+    return max_;
+}
+
+double Histogram::mean() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(sum_) / count_;
+}
+
+void stats::record(const Stage stage, const string_view format, const chrono::steady_clock::duration elapsed) {
+    const auto micros = chrono::duration_cast<chrono::microseconds>(elapsed).count();
+    thread_stats().slot(normalize_format(format)).stages[static_cast<size_t>(stage)].record(micros < 0 ? 0 : micros);
+}
+
+vector<StageSummary> stats::snapshot() {
+    vector<StageSummary> summaries;
+    lock_guard<mutex> lock(registry_mutex);
+    for (const auto& thread : registry) {
+        const size_t used = thread->used.load(memory_order_acquire);
+        for (size_t i = 0; i < used; i++) {
+            const FormatSlot& slot = *thread->slots[i];
+            for (size_t stage = 0; stage < stage_count; stage++) {
+                Histogram histogram;
+                slot.stages[stage].merge_into(histogram);
+                if (histogram.count() == 0) continue;
+
+                auto existing = find_if(summaries.begin(), summaries.end(), [&](const StageSummary& summary) {
+                    return summary.format == slot.name && summary.stage == static_cast<Stage>(stage);
+                });
+                if (existing == summaries.end()) {
+                    summaries.push_back({ slot.name, static_cast<Stage>(stage), histogram });
+                }
+                else {
+                    existing->histogram.merge(histogram);
+                }
+            }
+        }
+    }
+    sort(summaries.begin(), summaries.end(), [](const StageSummary& a, const StageSummary& b) {
+        return tie(a.format, a.stage) < tie(b.format, b.stage);
+    });
+    return summaries;
+}
+
+ScopedStage::ScopedStage(const Stage stage, const string_view format)
+    : stage_(stage), format_(format), start_(chrono::steady_clock::now()) {}
+
+ScopedStage::~ScopedStage() {
+    const auto end = chrono::steady_clock::now();
+    stats::record(stage_, format_, end - start_);
+    if (trace::enabled()) trace::record(stage_name(stage_), format_, start_, end);
+}
+
+void ScopedStage::set_format(const string_view format) {
+    format_ = format;
+}
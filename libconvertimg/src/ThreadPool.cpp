@@ -0,0 +1,164 @@
+#include "convertimg/ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+#include "convertimg/Numa.h"
+
+namespace {
+    // The pool and node the calling thread works for, so tasks a worker submits stay on its node.
+    thread_local ThreadPool* current_pool = nullptr;
+    thread_local size_t current_node = 0;
+}
+
+ThreadPool::ThreadPool(size_t threads, bool numa) : next_worker(0), stop(false) {
+    std::vector<NumaNode> topology;
+    if (numa) topology = numa::topology();
+    const bool pinned = topology.size() > 1;
+    if (numa && !pinned) spdlog::info("Only one NUMA node, worker threads are not pinned");
+    if (!pinned) topology.assign(1, NumaNode());
+
+    for (const NumaNode& numa_node : topology) {
+        nodes.push_back(std::make_unique<Node>());
+        nodes.back()->cpus = numa_node.cpus;
+    }
+
+    // Each worker goes to the node with the fewest workers per CPU.
+    std::vector<size_t> assigned(nodes.size(), 0);
+    for (size_t i = 0; i < threads; i++) {
+        size_t best = 0;
+        for (size_t n = 1; n < nodes.size(); n++) {
+            if (assigned[n] * topology[best].cpus.size() < assigned[best] * topology[n].cpus.size()) best = n;
+        }
+        assigned[best]++;
+        worker_nodes.push_back(best);
+    }
+    if (pinned) {
+        for (size_t n = 0; n < nodes.size(); n++) {
+            spdlog::info("NUMA node {}: {} worker thread(s) on {} CPU(s)", topology[n].id, assigned[n], topology[n].cpus.size());
+        }
+    }
+
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back([this, node = worker_nodes[i], pinned] { work(node, pinned); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        stop = true;
+    }
+    for (const auto& node : nodes) node->condition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::node_count() const {
+    return nodes.size();
+}
+
+ThreadPool* ThreadPool::current() {
+    return current_pool;
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) return;
+
+    // Helpers may only start after the call returned; they then find no index left and never touch `task`.
+    struct Shared {
+        const std::function<void(size_t)>* task;
+        size_t count;
+        std::atomic<size_t> next{ 0 };
+        std::mutex mutex;
+        std::condition_variable done;
+        size_t finished = 0;
+        std::exception_ptr error;
+
+        void run() {
+            size_t ran = 0;
+            for (size_t i; (i = next.fetch_add(1)) < count; ran++) {
+                try {
+                    (*task)(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error) error = std::current_exception();
+                }
+            }
+            if (ran == 0) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            finished += ran;
+            if (finished == count) done.notify_all();
+        }
+    };
+    auto shared = std::make_shared<Shared>();
+    shared->task = &task;
+    shared->count = count;
+
+    const size_t helpers = std::min(count, workers.size()) - (current_pool == this ? 1 : 0);
+    for (size_t i = 0; i < helpers && i + 1 < count; i++) enqueue([shared] { shared->run(); });
+    shared->run();
+
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&shared] { return shared->finished == shared->count; });
+    if (shared->error) std::rethrow_exception(shared->error);
+}
+
+size_t ThreadPool::target_node() {
+    if (current_pool == this) return current_node;
+    if (worker_nodes.empty()) return 0;
+    return worker_nodes[next_worker++ % worker_nodes.size()];
+}
+
+void ThreadPool::notify(size_t node) {
+    // Prefer an idle worker of the task's own node; an idle worker elsewhere has run dry and may take it.
+    for (size_t i = 0; i < nodes.size(); i++) {
+        Node& candidate = *nodes[(node + i) % nodes.size()];
+        if (candidate.idle == 0) continue;
+        candidate.idle--;
+        candidate.wakeups++;
+        candidate.condition.notify_one();
+        return;
+    }
+}
+
+void ThreadPool::work(size_t node, bool pinned) {
+    if (pinned) {
+        if (!numa::pin_current_thread(nodes[node]->cpus)) spdlog::warn("Failed to pin a worker thread to its NUMA node");
+        numa::prefer_local_memory();
+    }
+    current_pool = this;
+    current_node = node;
+
+    Node& own = *nodes[node];
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    while (true) {
+        // Own node first; otherwise steal from the node with the longest queue.
+        Node* source = &own;
+        if (own.tasks.empty()) {
+            for (const auto& other : nodes) {
+                if (other->tasks.size() > source->tasks.size()) source = other.get();
+            }
+        }
+        if (!source->tasks.empty()) {
+            {
+                std::function<void()> task = std::move(source->tasks.front());
+                source->tasks.pop_front();
+                lock.unlock();
+                task(); // execute the task
+            }
+            lock.lock();
+            continue;
+        }
+        if (stop) return;
+
+        own.idle++;
+        own.condition.wait(lock, [&own, this] { return stop || own.wakeups > 0; });
+        if (own.wakeups > 0) own.wakeups--;
+        else own.idle--;
+    }
+}
@@ -0,0 +1,176 @@
+#include "convertimg/Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "convertimg/Utils.h"
+
+using namespace std;
+
+namespace {
+    constexpr size_t detail_length = 47;
+
+    struct Event {
+        const char* name;
+        int64_t begin;     // microseconds since `trace::start`
+        int64_t duration;  // microseconds
+        char detail[detail_length + 1];
+    };
+
+    // Written only by its owning thread; read by `trace::write` once the traced work is done.
+    struct Ring {
+        vector<Event> events;
+        atomic<uint64_t> written{ 0 };
+        bool in_use = true;  // guarded by registry_mutex
+    };
+
+    atomic<bool> tracing{ false };
+    chrono::steady_clock::time_point epoch;
+    size_t capacity = 0;
+
+    mutex registry_mutex;
+    vector<unique_ptr<Ring>> rings;  // index = trace thread id
+
+    // Returns the ring to the pool when its thread exits; the recorded events are kept.
+    struct RingHandle {
+        Ring* ring = nullptr;
+
+        ~RingHandle() {
+            if (ring == nullptr) return;
+            lock_guard<mutex> lock(registry_mutex);
+            ring->in_use = false;
+        }
+    };
+
+    Ring& thread_ring() {
+        thread_local RingHandle handle;
+        if (handle.ring == nullptr) {
+            lock_guard<mutex> lock(registry_mutex);
+            for (const auto& ring : rings) {
+                if (!ring->in_use) {
+                    ring->in_use = true;
+                    handle.ring = ring.get();
+                    break;
+                }
+            }
+            if (handle.ring == nullptr) {
+                rings.push_back(make_unique<Ring>());
+                rings.back()->events.resize(capacity);
+                handle.ring = rings.back().get();
+            }
+        }
+        return *handle.ring;
+    }
+
+    // Keeps the tail of long details (the file name of a path), without splitting a UTF-8 sequence.
+    void copy_detail(char* target, string_view detail) {
+        if (detail.size() > detail_length) {
+            detail.remove_prefix(detail.size() - detail_length);
+            while (!detail.empty() && (static_cast<unsigned char>(detail[0]) & 0xC0) == 0x80) detail.remove_prefix(1);
+        }
+        copy(detail.begin(), detail.end(), target);
+        target[detail.size()] = '\0';
+    }
+
+    void write_json_string(ostream& out, const char* text) {
+        out << '"';
+        for (const char* c = text; *c != '\0'; c++) {
+            switch (*c) {
+                case '"': out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                default:
+                    if (static_cast<unsigned char>(*c) < 0x20) {
+                        char escaped[8];
+                        snprintf(escaped, sizeof(escaped), "\\u%04x", *c);
+                        out << escaped;
+                    }
+                    else {
+                        out << *c;
+                    }
+            }
+        }
+        out << '"';
+    }
+
+    int64_t micros_since_epoch(const chrono::steady_clock::time_point time) {
+        return chrono::duration_cast<chrono::microseconds>(time - epoch).count();
+    }
+}
+
+void trace::start(const size_t events_per_thread) {
+    lock_guard<mutex> lock(registry_mutex);
+    capacity = max<size_t>(events_per_thread, 1);
+    epoch = chrono::steady_clock::now();
+    for (const auto& ring : rings) {
+        ring->events.assign(capacity, Event{});
+        ring->written.store(0, memory_order_relaxed);
+    }
+    tracing.store(true, memory_order_release);
+}
+
+void trace::stop() {
+    tracing.store(false, memory_order_release);
+}
+
+bool trace::enabled() {
+    return tracing.load(memory_order_acquire);
+}
+
+void trace::record(const char* name, const string_view detail,
+    const chrono::steady_clock::time_point begin, const chrono::steady_clock::time_point end)
+{
+    if (!enabled()) return;
+    Ring& ring = thread_ring();
+    const uint64_t index = ring.written.load(memory_order_relaxed);
+    Event& event = ring.events[index % ring.events.size()];
+    event.name = name;
+    event.begin = micros_since_epoch(begin);
+    event.duration = chrono::duration_cast<chrono::microseconds>(end - begin).count();
+    copy_detail(event.detail, detail);
+    ring.written.store(index + 1, memory_order_release);
+}
+
+void trace::write(const string& path) {
+    ofstream out(path);
+    if (!out) throw runtime_error("Failed to open trace file: " + utils::quote(path));
+
+    lock_guard<mutex> lock(registry_mutex);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (size_t tid = 0; tid < rings.size(); tid++) {
+        const Ring& ring = *rings[tid];
+        const uint64_t written = ring.written.load(memory_order_acquire);
+        if (written == 0) continue;
+
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+            << ",\"args\":{\"name\":\"thread " << tid << "\"}}";
+        first = false;
+
+        const uint64_t count = min<uint64_t>(written, ring.events.size());
+        for (uint64_t i = written - count; i < written; i++) {
+            const Event& event = ring.events[i % ring.events.size()];
+            out << ",\n{\"name\":";
+            write_json_string(out, event.name);
+            out << ",\"cat\":\"convert\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << event.begin << ",\"dur\":" << event.duration << ",\"args\":{\"detail\":";
+            write_json_string(out, event.detail);
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+    if (!out) throw runtime_error("Failed to write trace file: " + utils::quote(path));
+}
+
+trace::Span::Span(const char* name, const string_view detail)
+    : name_(name), detail_(detail), begin_(chrono::steady_clock::now()) {}
+
+trace::Span::~Span() {
+    if (enabled()) record(name_, detail_, begin_, chrono::steady_clock::now());
+}
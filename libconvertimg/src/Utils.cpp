@@ -0,0 +1,90 @@
+#include "convertimg/Utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <spdlog/spdlog.h>
+
+#include "convertimg/FormatSniff.h"
+
+using namespace std;
+
+
+// Moved repetitive utility functions here to reduce redundancy
+namespace utils {
+    string quote(const string& str) {
+        return "\"" + str + "\"";
+    }
+
+    bool is_file(const string& path) {
+        return filesystem::is_regular_file(path);
+    }
+
+    bool is_directory(const string& path)
+    {
+    	return filesystem::is_directory(path);
+	}
+
+    string get_extension(const string& path) {
+        return filesystem::path(path).extension().string();
+    }
+
+    vector<string> split(const string& str, const char delimiter) {
+        vector<string> parts;
+        size_t start = 0;
+        while (true) {
+            const size_t end = str.find(delimiter, start);
+            parts.push_back(str.substr(start, end - start));
+            if (end == string::npos) break;
+            start = end + 1;
+        }
+        return parts;
+    }
+
+    vector<string> get_files(const string& path, const string& ext)
+	{
+        vector<string> candidates;
+        for (const auto& entry : filesystem::directory_iterator(path)) 
+        {
+            const string& file_path = entry.path().string();
+            if (is_file(file_path)) candidates.push_back(file_path);
+        }
+
+        enum : char { Keep, OtherFormat, NotImage };
+        const string wanted = ext.empty() ? "" : sniff::canonical_format(ext);
+        const auto classify = [&](const string& file_path) -> char {
+            string format = sniff::detect_file(file_path);
+            if (format.empty()) {
+                format = sniff::canonical_format(get_extension(file_path));
+                if (!sniff::is_headerless_format(format)) return NotImage;
+            }
+            return wanted.empty() || format == wanted ? Keep : OtherFormat;
+        };
+
+        // Headers are read in batches on a few threads, as every open is a round trip on network filesystems.
+        constexpr size_t batch_size = 256;
+        const size_t batches = (candidates.size() + batch_size - 1) / batch_size;
+        vector<char> verdicts(candidates.size(), NotImage);
+        atomic<size_t> next_batch{ 0 };
+        const auto read_batches = [&] {
+            for (size_t batch; (batch = next_batch++) < batches;) {
+                for (size_t i = batch * batch_size; i < min(candidates.size(), (batch + 1) * batch_size); i++) verdicts[i] = classify(candidates[i]);
+            }
+        };
+        vector<thread> readers;
+        const size_t reader_count = min<size_t>(batches, min(8u, max(thread::hardware_concurrency(), 1u)));
+        for (size_t r = 1; r < reader_count; r++) readers.emplace_back(read_batches);
+        read_batches();
+        for (auto& reader : readers) reader.join();
+
+        vector<string> files;
+        size_t not_images = 0;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (verdicts[i] == Keep) files.push_back(std::move(candidates[i]));
+            else if (verdicts[i] == NotImage) not_images++;
+        }
+        if (not_images != 0) spdlog::info("Skipped {} files in {} that are not images", not_images, quote(path));
+        return files;
+    }
+}  // namespace utils
@@ -0,0 +1,116 @@
+#include "convertimg/convertimg.h"
+
+#include <cstring>
+#include <exception>
+#include <new>
+
+#include "convertimg/ConvertEngine.h"
+
+using namespace std;
+
+struct cimg_engine {
+    ConvertEngine engine;
+
+    explicit cimg_engine(const unsigned int threads) : engine(threads) {}
+};
+
+namespace {
+    // Copies the fields this caller's struct actually has; anything newer keeps its default.
+    ConvertJob to_job(const cimg_job* source) {
+        cimg_job job;
+        cimg_job_init(&job);
+        memcpy(&job, source, min(source->struct_size, sizeof(job)));
+
+        ConvertJob converted;
+        if (job.input_path) converted.input_path = job.input_path;
+        converted.input_data = job.input_data;
+        converted.input_size = job.input_size;
+        if (job.output_path) converted.output_path = job.output_path;
+        if (job.format) converted.format = job.format;
+        converted.quality = job.quality;
+        converted.compression = job.compression == CIMG_COMPRESSION_LOSSY ? CompressionMode::Lossy
+            : job.compression == CIMG_COMPRESSION_LOSSLESS ? CompressionMode::Lossless : CompressionMode::None;
+        converted.scale = job.scale;
+        converted.max_width = job.max_width;
+        converted.overwrite = job.overwrite != 0;
+        return converted;
+    }
+
+    void report(const ConvertResult& result, const cimg_callback callback, void* user_data) {
+        if (!callback) return;
+        cimg_result out{};
+        out.struct_size = sizeof(out);
+        out.ok = result.ok ? 1 : 0;
+        out.error = result.ok ? nullptr : result.error.c_str();
+        out.output_path = result.output_path.empty() ? nullptr : result.output_path.c_str();
+        out.output_data = result.output.length() ? result.output.data() : nullptr;
+        out.output_size = result.output.length();
+        out.milliseconds = result.milliseconds;
+        callback(user_data, &out);
+    }
+}  // namespace
+
+extern "C" {
+
+int cimg_abi_version(void) {
+    return CIMG_ABI_VERSION;
+}
+
+void cimg_job_init(cimg_job* job) {
+    memset(job, 0, sizeof(*job));
+    job->struct_size = sizeof(*job);
+    job->quality = 80;
+    job->compression = CIMG_COMPRESSION_NONE;
+    job->scale = 1.0;
+}
+
+cimg_engine* cimg_engine_create(const unsigned int threads) {
+    try {
+        return new cimg_engine(threads);
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
+
+void cimg_engine_destroy(cimg_engine* engine) {
+    delete engine;
+}
+
+int cimg_submit(cimg_engine* engine, const cimg_job* job, const cimg_callback callback, void* user_data) {
+    if (!engine || !job) return -1;
+    try {
+        engine->engine.submit(to_job(job), [callback, user_data](const ConvertJob&, ConvertResult& result) {
+            report(result, callback, user_data);
+        });
+        return 0;
+    }
+    catch (...) {
+        return -1;
+    }
+}
+
+int cimg_convert(cimg_engine* engine, const cimg_job* job, const cimg_callback callback, void* user_data) {
+    if (!engine || !job) return 0;
+    ConvertResult result;
+    try {
+        result = ConvertEngine::convert(to_job(job));
+    }
+    catch (const exception& e) {
+        result = ConvertResult{};
+        result.error = e.what();
+    }
+    catch (...) {
+        result = ConvertResult{};
+        result.error = "unknown error";
+    }
+    // Reported outside the `try` so a failure still reaches the caller exactly once.
+    report(result, callback, user_data);
+    return result.ok ? 1 : 0;
+}
+
+void cimg_engine_wait(cimg_engine* engine) {
+    if (engine) engine->engine.wait();
+}
+
+}  // extern "C"